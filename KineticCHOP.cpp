@@ -12,19 +12,90 @@
 * prior written permission from Derivative.
 */
 
+#ifdef KINETIC_PYTHON
+// Python.h has to come before any standard headers. TouchDesigner only
+// ships a release Python, which debug builds link against too rather than
+// the debug library pyconfig.h asks for under _DEBUG.
+#if defined(_MSC_VER) && defined(_DEBUG)
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#endif
+
+#ifdef _WIN32
+// Winsock 2 has to come before windows.h, which CPlusPlus_Common.h includes
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "winmm.lib")
+#endif
+
 #include "KineticCHOP.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include <cmath>
 #include <assert.h>
 
 #include <iostream>
 #include <array>
+#include <algorithm>
 #include <stdexcept>
+#include <new>
+#include <cstddef>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <errno.h>
+#include <termios.h>
+#endif
 
 const double PI = 3.14159265358979323846;
 
+// Scratch memory computeFrame() takes from the frame arena for a frame of
+// 'numFixtures' fixtures, with room to align each allocation. Every
+// allocation computeFrame() makes has its line here.
+static size_t frameArenaBytes(size_t numFixtures) {
+	const size_t numPoseChannels = numFixtures * NUM_POSE_CHANNELS;
+	const size_t allocations[] = {
+		MAX_POSE_SAMPLES * numPoseChannels * sizeof(float),	// smoothed
+		numPoseChannels * sizeof(float),					// pose
+		numFixtures * 3 * sizeof(float),					// motorHeights
+		numFixtures * 3 * sizeof(uint8_t),					// motorDMX
+		numFixtures * 3 * sizeof(uint8_t),					// motorFine
+		numFixtures * sizeof(bool),							// fixtureValid
+		numFixtures * 3 * sizeof(uint16_t),					// limited
+		numPoseChannels * sizeof(float),					// samplePose
+		numPoseChannels * sizeof(float),					// lead
+	};
+	size_t bytes = 0;
+	for (size_t allocation : allocations)
+		bytes += allocation + alignof(std::max_align_t);
+	return bytes;
+}
+
+#ifndef KINETIC_ALLOC_AUDIT
+uint64_t threadAllocationCount() {
+	return 0;
+}
+#endif
+
 // Helper function to convert degrees to radians
 inline double degreesToRadians(double degrees) {
 	return degrees * PI / 180.0;
@@ -36,6 +107,11 @@ T clamp(T value, T min, T max) {
 	return std::min(std::max(value, min), max);
 }
 
+// The newest sample of an input channel, the one a cook outputs
+inline float newestSample(const OP_CHOPInput* input, int32_t channel) {
+	return input->getChannelData(channel)[std::max(input->numSamples - 1, 0)];
+}
+
 // Helper function to convert height to DMX value
 uint8_t heightToDMX(float height, float min_height, float max_height, float min_dmx, float max_dmx) {
 	//if (min_height >= max_height) {
@@ -114,6 +190,471 @@ std::array<double, 3> calculateMotorHeights(double base_size, double roll_deg, d
 	return heights;
 }
 
+// Calculate motor heights of many fixtures from the normal of the plane each
+// one should take. The motors sit on the same triangle as in
+// calculateMotorHeights(), with its Z up mapped to the SOP's Y up, and each
+// motor moves to where the plane through the fixture's center passes over it.
+void calculatePlaneMotorHeights(double base_size, const float* nx, const float* ny, const float* nz,
+								size_t count, size_t stride, float* heights) {
+	// Motor positions on the SOP's XZ plane, relative to the triangle's center
+	const float s = static_cast<float>(base_size);
+	const float r = s * static_cast<float>(sqrt(3.0) / 6.0);
+	const float anchorX[3] = { -s / 2, s / 2, 0.0f };
+	const float anchorZ[3] = { r, r, -2.0f * r };
+
+	for (size_t f = 0; f < count; f++) {
+		// A normal facing sideways or down has no height over the base, so the
+		// motors are pushed out of range and the fixture is zeroed
+		size_t i = f * stride;
+		bool facingUp = ny[i] > 1e-6f;
+		float inv = facingUp ? 1.0f / ny[i] : 0.0f;
+		for (int m = 0; m < 3; m++)
+			heights[f * 3 + m] = facingUp ? -(nx[i] * anchorX[m] + nz[i] * anchorZ[m]) * inv : HUGE_VALF;
+	}
+}
+
+// Calculate motor heights of many fixtures from roll, pitch and yaw
+void calculateRotationMotorHeights(double base_size, const float* rolls, const float* pitches, const float* yaws,
+								   size_t count, size_t stride, float* heights) {
+	for (size_t f = 0; f < count; f++) {
+		size_t i = f * stride;
+		std::array<double, 3> fixtureHeights = calculateMotorHeights(base_size, rolls[i], pitches[i], yaws[i]);
+		for (int m = 0; m < 3; m++)
+			heights[f * 3 + m] = static_cast<float>(fixtureHeights[m]);
+	}
+}
+
+// Convert roll, pitch and yaw to the quaternion of the same rotation as
+// calculateMotorHeights(), yaw first, then pitch, then roll
+void rotationToQuaternions(const float* rolls, const float* pitches, const float* yaws, size_t count, size_t stride,
+						   float* w, float* x, float* y, float* z) {
+	for (size_t f = 0; f < count; f++) {
+		size_t i = f * stride;
+		double r = degreesToRadians(rolls[i]) / 2, p = degreesToRadians(pitches[i]) / 2, yw = degreesToRadians(yaws[i]) / 2;
+		double cr = cos(r), sr = sin(r), cp = cos(p), sp = sin(p), cy = cos(yw), sy = sin(yw);
+		w[f] = static_cast<float>(cr * cp * cy - sr * sp * sy);
+		x[f] = static_cast<float>(sr * cp * cy + cr * sp * sy);
+		y[f] = static_cast<float>(cr * sp * cy - sr * cp * sy);
+		z[f] = static_cast<float>(cr * cp * sy + sr * sp * cy);
+	}
+}
+
+// Calculate motor heights of many fixtures straight from their quaternions.
+// The rotated base plane's normal is the matrix's bottom row, so each motor
+// rises by the normal's dot product with its position on the triangle.
+void calculateQuaternionMotorHeights(double base_size, const float* w, const float* x, const float* y, const float* z,
+									 size_t count, float* heights) {
+	// Motor positions relative to the triangle's center, as in calculateMotorHeights()
+	const float s = static_cast<float>(base_size);
+	const float r = s * static_cast<float>(sqrt(3.0) / 6.0);
+	const float anchorX[3] = { -s / 2, s / 2, 0.0f };
+	const float anchorY[3] = { -r, -r, 2.0f * r };
+
+	for (size_t f = 0; f < count; f++) {
+		float nx = 2.0f * (x[f] * z[f] - w[f] * y[f]);
+		float ny = 2.0f * (y[f] * z[f] + w[f] * x[f]);
+		for (int m = 0; m < 3; m++)
+			heights[f * 3 + m] = nx * anchorX[m] + ny * anchorY[m];
+	}
+}
+
+// sin() for angles between 0 and pi/2, as a polynomial so the slerp loop
+// has no calls in it
+inline float sinQuarterTurn(float a) {
+	float a2 = a * a;
+	return a * (1.0f + a2 * (-1.0f / 6 + a2 * (1.0f / 120 + a2 * (-1.0f / 5040 + a2 * (1.0f / 362880 + a2 * (-1.0f / 39916800))))));
+}
+
+// Flip each fixture's starting quaternion into the target's hemisphere so the
+// slerp takes the short way round, and find the angle between them
+void prepareSlerp(float* from, const float* to, size_t count, float* angles) {
+	for (size_t f = 0; f < count; f++) {
+		float dot = 0.0f;
+		for (int c = ORIENT_W; c <= ORIENT_Z; c++)
+			dot += from[c * count + f] * to[c * count + f];
+		if (dot < 0.0f) {
+			for (int c = ORIENT_W; c <= ORIENT_Z; c++)
+				from[c * count + f] = -from[c * count + f];
+			dot = -dot;
+		}
+		angles[f] = static_cast<float>(acos(std::min(dot, 1.0f)));
+	}
+}
+
+// Slerp the orientations and lerp the heights of many fixtures. Branch free
+// over structure of arrays blocks, so the compiler can vectorize it.
+void slerpOrientations(const float* from, const float* to, const float* angles, float t, size_t count, float* out) {
+	for (size_t f = 0; f < count; f++) {
+		float angle = angles[f];
+		bool tiny = angle < 1e-3f;
+		float invSin = tiny ? 0.0f : 1.0f / sinQuarterTurn(angle);
+		float a = tiny ? 1.0f - t : sinQuarterTurn((1.0f - t) * angle) * invSin;
+		float b = tiny ? t : sinQuarterTurn(t * angle) * invSin;
+		for (int c = ORIENT_W; c <= ORIENT_Z; c++)
+			out[c * count + f] = a * from[c * count + f] + b * to[c * count + f];
+		out[ORIENT_HEIGHT * count + f] = from[ORIENT_HEIGHT * count + f] + (to[ORIENT_HEIGHT * count + f] - from[ORIENT_HEIGHT * count + f]) * t;
+	}
+}
+
+// Keys cubic convolution kernel (a = -0.5, Catmull-Rom)
+inline float cubicKernel(float x) {
+	x = fabsf(x);
+	if (x < 1.0f)
+		return (1.5f * x - 2.5f) * x * x + 1.0f;
+	if (x < 2.0f)
+		return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+	return 0.0f;
+}
+
+// Interpolate rows of numChannels values at a fractional row position. The
+// filter is stretched by 'scale' when decimating, so it also low-passes
+// what the output rate can't carry. Rows past either end are left out and
+// the weights renormalized.
+void resampleRows(const float* rows, int32_t numRows, size_t numChannels, float position, float scale,
+				  ResampleFilter filter, float* out) {
+	position = clamp(position, 0.0f, static_cast<float>(numRows - 1));
+	float support = (filter == ResampleFilter::Cubic ? 2.0f : 1.0f) * scale;
+	int32_t first = std::max(0, static_cast<int32_t>(ceil(position - support)));
+	int32_t last = std::min(numRows - 1, static_cast<int32_t>(floor(position + support)));
+
+	std::fill(out, out + numChannels, 0.0f);
+	float weightSum = 0.0f;
+	for (int32_t r = first; r <= last; r++) {
+		float x = (r - position) / scale;
+		float weight = filter == ResampleFilter::Cubic ? cubicKernel(x) : std::max(0.0f, 1.0f - fabsf(x));
+		const float* row = rows + r * numChannels;
+		for (size_t c = 0; c < numChannels; c++)
+			out[c] += weight * row[c];
+		weightSum += weight;
+	}
+
+	if (weightSum != 0.0f) {
+		float inv = 1.0f / weightSum;
+		for (size_t c = 0; c < numChannels; c++)
+			out[c] *= inv;
+	}
+	else {
+		const float* row = rows + static_cast<int32_t>(position + 0.5f) * numChannels;
+		std::copy(row, row + numChannels, out);
+	}
+}
+
+// Map the motor heights of many fixtures, relative to each fixture's height,
+// to DMX values. A fixture whose motors are all out of range is invalid.
+// A fixture whose motors are all below or all above the height range is out of range
+inline bool motorsInRange(const MotorMapping& mapping, const float* h) {
+	return !(((h[0] < mapping.minHeight) && (h[1] < mapping.minHeight) && (h[2] < mapping.minHeight)) ||
+			 ((h[0] > mapping.maxHeight) && (h[1] > mapping.maxHeight) && (h[2] > mapping.maxHeight)));
+}
+
+void mapMotorHeights(const MotorMapping& mapping, const float* fixtureHeights, size_t stride, const float* motorHeights,
+					 size_t count, uint8_t* motorDMX, bool* valid) {
+	for (size_t f = 0; f < count; f++) {
+		const float* h = motorHeights + f * 3;
+		valid[f] = motorsInRange(mapping, h);
+
+		for (int m = 0; m < 3; m++)
+			motorDMX[f * 3 + m] = heightToDMX(h[m] + fixtureHeights[f * stride], mapping.calMinHeight, mapping.calMaxHeight, mapping.calMinDMX, mapping.calMaxDMX);
+	}
+}
+
+// mapMotorHeights() in 16 bit DMX, the calibrated DMX value times 256
+void mapMotorHeights16(const MotorMapping& mapping, const float* fixtureHeights, size_t stride, const float* motorHeights,
+					   size_t count, uint16_t* motorDMX, bool* valid) {
+	const float minDMX = static_cast<float>(mapping.calMinDMX);
+	const float maxDMX = static_cast<float>(mapping.calMaxDMX);
+	const float scale = static_cast<float>((mapping.calMaxDMX - mapping.calMinDMX) / (mapping.calMaxHeight - mapping.calMinHeight));
+	for (size_t f = 0; f < count; f++) {
+		const float* h = motorHeights + f * 3;
+		valid[f] = motorsInRange(mapping, h);
+
+		for (int m = 0; m < 3; m++) {
+			float height = h[m] + fixtureHeights[f * stride];
+			float value = clamp((height - static_cast<float>(mapping.calMinHeight)) * scale + minDMX, minDMX, maxDMX);
+			motorDMX[f * 3 + m] = static_cast<uint16_t>(std::min(value * 256.0f + 0.5f, 65535.0f));
+		}
+	}
+}
+
+// Parse an Additional DMX channel name of the form 'f<fixture>_dmx<slot>'
+// or 'dmx<slot>'. Fixture and slot numbers are 1-based in the name, the
+// returned fixture index is 0-based.
+bool parseDMXChannelName(const char* name, int32_t& fixture, int32_t& slot) {
+	fixture = 0;
+	if (name[0] == 'f') {
+		char* end = nullptr;
+		long f = strtol(name + 1, &end, 10);
+		if (end == name + 1 || f < 1 || *end != '_')
+			return false;
+		fixture = static_cast<int32_t>(f - 1);
+		name = end + 1;
+	}
+	if (strncmp(name, "dmx", 3) != 0)
+		return false;
+
+	char* end = nullptr;
+	long s = strtol(name + 3, &end, 10);
+	if (end == name + 3 || *end != '\0' || s < 1 || s > KineticLight::NUM_SLOTS)
+		return false;
+	slot = static_cast<int32_t>(s);
+	return true;
+}
+
+// Pose channel named by a packed pose input channel, or -1. The name is split
+// into runs of letters, any of which may be h/height, r/roll, p/pitch or
+// y/yaw, so 'h1', 'roll_3' and 'fx2_pitch' are all recognized.
+int32_t parsePoseChannelName(const char* name) {
+	static const char* const kinds[][2] = { { "h", "height" }, { "r", "roll" }, { "p", "pitch" }, { "y", "yaw" } };
+	while (*name) {
+		if (!isalpha(static_cast<unsigned char>(*name))) {
+			name++;
+			continue;
+		}
+		const char* start = name;
+		while (isalpha(static_cast<unsigned char>(*name)))
+			name++;
+		size_t length = name - start;
+		for (int32_t c = 0; c < NUM_POSE_CHANNELS; c++) {
+			for (const char* kind : kinds[c]) {
+				size_t i = 0;
+				while (i < length && kind[i] == tolower(static_cast<unsigned char>(start[i])))
+					i++;
+				if (i == length && kind[i] == '\0')
+					return c;
+			}
+		}
+	}
+	return -1;
+}
+
+static void appendUInt16(std::vector<uint8_t>& out, size_t value) {
+	out.push_back(static_cast<uint8_t>(value & 0xFF));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+// Encodes the slots of 'frame' that differ from 'previous' as baked show
+// delta runs into 'out'. Unchanged gaps shorter than a run header are
+// copied instead of starting a new run.
+void encodeBakeDelta(const uint8_t* previous, const uint8_t* frame, size_t size, std::vector<uint8_t>& out) {
+	const size_t RUN_HEADER = 4;
+	out.clear();
+	size_t last = 0;
+	size_t i = 0;
+	while (i < size) {
+		if (frame[i] == previous[i]) {
+			i++;
+			continue;
+		}
+		size_t start = i;
+		size_t end = i + 1;
+		for (size_t next = end; next < size && next - end < RUN_HEADER; next++) {
+			if (frame[next] != previous[next])
+				end = next + 1;
+		}
+
+		// Skips and runs longer than 16 bits are split into several runs
+		size_t skip = start - last;
+		while (skip > 0xFFFF) {
+			appendUInt16(out, 0xFFFF);
+			appendUInt16(out, 0);
+			skip -= 0xFFFF;
+		}
+		while (start < end) {
+			size_t length = std::min<size_t>(end - start, 0xFFFF);
+			appendUInt16(out, skip);
+			appendUInt16(out, length);
+			out.insert(out.end(), frame + start, frame + start + length);
+			start += length;
+			skip = 0;
+		}
+		last = i = end;
+	}
+}
+
+// Applies a baked frame to 'slots', returns false if the frame is malformed
+bool applyBakeFrame(const uint8_t* data, const BakeFrameEntry& entry, uint8_t* slots, size_t numSlots) {
+	const uint8_t* p = data + entry.offset;
+	if (!entry.delta) {
+		if (entry.size != numSlots)
+			return false;
+		memcpy(slots, p, numSlots);
+		return true;
+	}
+
+	const uint8_t* end = p + entry.size;
+	size_t slot = 0;
+	while (p < end) {
+		if (end - p < 4)
+			return false;
+		size_t skip = p[0] | (p[1] << 8);
+		size_t length = p[2] | (p[3] << 8);
+		p += 4;
+		slot += skip;
+		if (slot + length > numSlots || static_cast<size_t>(end - p) < length)
+			return false;
+		memcpy(slots + slot, p, length);
+		p += length;
+		slot += length;
+	}
+	return true;
+}
+
+#ifdef _WIN32
+// TouchDesigner passes paths as UTF-8, Windows file APIs want UTF-16
+static std::wstring widePath(const char* path) {
+	int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	std::wstring wide(length > 0 ? length - 1 : 0, L'\0');
+	if (length > 1)
+		MultiByteToWideChar(CP_UTF8, 0, path, -1, &wide[0], length);
+	return wide;
+}
+#endif
+
+// Reads a text table, one row per line with cells separated by tabs, or by
+// commas on lines without tabs
+bool readTableFile(const char* path, std::vector<std::vector<std::string>>& table) {
+#ifdef _WIN32
+	std::ifstream file(widePath(path));
+#else
+	std::ifstream file(path);
+#endif
+	if (!file)
+		return false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		char separator = line.find('\t') != std::string::npos ? '\t' : ',';
+		std::vector<std::string> row;
+		size_t start = 0;
+		for (;;) {
+			size_t end = line.find(separator, start);
+			row.push_back(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+			if (end == std::string::npos)
+				break;
+			start = end + 1;
+		}
+		table.push_back(std::move(row));
+	}
+	return true;
+}
+
+#ifdef KINETIC_PYTHON
+// Python batch API. Poses are float32 buffers (numpy arrays, array.array,
+// ...) with 4 values per fixture. Motor heights come back as 3 float32 per
+// fixture and DMX values as 3 bytes per fixture, written into the buffers
+// passed in, which have to be float32 and uint8, or into new bytearrays.
+// The GIL is released while solving.
+
+// Accepts native buffer formats of 'code' items ('f', '<f', '=f', '@f')
+static bool hasItemFormat(const Py_buffer& view, char code, Py_ssize_t itemsize) {
+	// No format means unsigned bytes
+	const char* format = view.format ? view.format : "B";
+	size_t length = strlen(format);
+	return view.itemsize == itemsize && length > 0 && format[length - 1] == code &&
+		(length == 1 || (length == 2 && strchr("<=@", format[0])));
+}
+
+static bool isFloat32Format(const Py_buffer& view) {
+	return hasItemFormat(view, 'f', sizeof(float));
+}
+
+static bool isUInt8Format(const Py_buffer& view) {
+	return hasItemFormat(view, 'B', 1);
+}
+
+// Returns a new reference to 'given', or a new bytearray of 'bytes'
+static PyObject* resultBuffer(PyObject* given, Py_ssize_t bytes) {
+	if (given && given != Py_None) {
+		Py_INCREF(given);
+		return given;
+	}
+	return PyByteArray_FromStringAndSize(nullptr, bytes);
+}
+
+static PyObject* solveBuffers(PyObject* self, PyObject* args, bool planes) {
+	PyObject* posesObject;
+	PyObject* heightsObject = nullptr;
+	PyObject* dmxObject = nullptr;
+	if (!PyArg_ParseTuple(args, "O|OO", &posesObject, &heightsObject, &dmxObject))
+		return nullptr;
+
+	PY_Struct* me = reinterpret_cast<PY_Struct*>(self);
+	PY_GetInfo info;
+	info.autoCook = true;
+	const CPlusPlusCHOPExample* instance = static_cast<const CPlusPlusCHOPExample*>(me->context->getNodeInstance(info));
+	if (!instance) {
+		PyErr_SetString(PyExc_RuntimeError, "Kinetic Light node is not available.");
+		return nullptr;
+	}
+
+	Py_buffer poses;
+	if (PyObject_GetBuffer(posesObject, &poses, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0)
+		return nullptr;
+	if (!isFloat32Format(poses) || poses.len % (NUM_POSE_CHANNELS * sizeof(float))) {
+		PyBuffer_Release(&poses);
+		PyErr_SetString(PyExc_TypeError, "Poses must be a float32 buffer with 4 values per fixture.");
+		return nullptr;
+	}
+	size_t count = poses.len / (NUM_POSE_CHANNELS * sizeof(float));
+
+	PyObject* heightsResult = resultBuffer(heightsObject, count * 3 * sizeof(float));
+	PyObject* dmxResult = resultBuffer(dmxObject, count * 3);
+	Py_buffer heights = {}, dmx = {};
+	bool haveHeights = false, haveDMX = false;
+	if (heightsResult && dmxResult) {
+		haveHeights = PyObject_GetBuffer(heightsResult, &heights, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE | PyBUF_FORMAT) == 0;
+		haveDMX = haveHeights && PyObject_GetBuffer(dmxResult, &dmx, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE | PyBUF_FORMAT) == 0;
+		// New results are plain bytearrays, but buffers passed in have to
+		// hold the types written into them
+		if (haveDMX && heightsResult == heightsObject && !isFloat32Format(heights))
+			PyErr_SetString(PyExc_TypeError, "Heights must be a writable float32 buffer.");
+		else if (haveDMX && dmxResult == dmxObject && !isUInt8Format(dmx))
+			PyErr_SetString(PyExc_TypeError, "DMX must be a writable uint8 buffer.");
+		else if (haveDMX && (heights.len < Py_ssize_t(count * 3 * sizeof(float)) || dmx.len < Py_ssize_t(count * 3)))
+			PyErr_SetString(PyExc_ValueError, "Output buffers need room for 3 float32 heights and 3 DMX bytes per fixture.");
+	}
+
+	bool ok = haveDMX && !PyErr_Occurred();
+	if (ok) {
+		Py_BEGIN_ALLOW_THREADS
+		instance->solvePoses(static_cast<const float*>(poses.buf), count, planes,
+							 static_cast<float*>(heights.buf), static_cast<uint8_t*>(dmx.buf));
+		Py_END_ALLOW_THREADS
+	}
+
+	if (haveDMX)
+		PyBuffer_Release(&dmx);
+	if (haveHeights)
+		PyBuffer_Release(&heights);
+	PyBuffer_Release(&poses);
+	if (!ok) {
+		Py_XDECREF(heightsResult);
+		Py_XDECREF(dmxResult);
+		return nullptr;
+	}
+	return Py_BuildValue("(NN)", heightsResult, dmxResult);
+}
+
+static PyObject* pySolvePoses(PyObject* self, PyObject* args) {
+	return solveBuffers(self, args, false);
+}
+
+static PyObject* pySolvePlanes(PyObject* self, PyObject* args) {
+	return solveBuffers(self, args, true);
+}
+
+static PyMethodDef pythonMethods[] = {
+	{ "solvePoses", pySolvePoses, METH_VARARGS,
+	  "solvePoses(poses, heights=None, dmx=None) -> (heights, dmx)\n"
+	  "Motor heights and DMX values for rows of height, roll, pitch, yaw." },
+	{ "solvePlanes", pySolvePlanes, METH_VARARGS,
+	  "solvePlanes(poses, heights=None, dmx=None) -> (heights, dmx)\n"
+	  "Motor heights and DMX values for rows of height and plane normal x, y, z." },
+	{ nullptr, nullptr, 0, nullptr }
+};
+#endif
 
 // These functions are basic C function, which the DLL loader can find
 // much easier than finding a C++ Class.
@@ -141,14 +682,22 @@ FillCHOPPluginInfo(CHOP_PluginInfo *info)
 	info->customOPInfo.authorName->setString("Kavinda Madhubhashana");
 	info->customOPInfo.authorEmail->setString("kmkavinda6@gmail.com");
 
-	// This CHOP can work with 4 inputs
-	// The inputs are connected height, roll, pitch and yaw
-	info->customOPInfo.minInputs = 4;
+	// This CHOP can work without inputs
+	// The inputs are connected height, roll, pitch and yaw, or a single
+	// packed pose input. Poses can also come from the Pose SOP parameter.
+	info->customOPInfo.minInputs = 0;
 
 	// It can accept up to 5 input though, which changes it's behavior
 	// The 5th input is speed 
 	// The 6th input is Additional DMX values
 	info->customOPInfo.maxInputs = 6;
+
+#ifdef KINETIC_PYTHON
+	// Batch kinematics for pre-rendering and validating shows from Python
+	info->customOPInfo.pythonVersion->setString(PY_VERSION);
+	info->customOPInfo.pythonMethods = pythonMethods;
+	info->customOPInfo.pythonDoc = "Kinetic Light CHOP. solvePoses() and solvePlanes() run the motor kinematics over buffers of poses.";
+#endif
 }
 
 DLLEXPORT
@@ -177,18 +726,97 @@ CPlusPlusCHOPExample::CPlusPlusCHOPExample(const OP_NodeInfo* info) : myNodeInfo
 {
 	myExecuteCount = 0;
 	myOffset = 0.0;
-
-	// Initialize KineticLight with appropriate motor types
-	kineticLight = std::make_unique<KineticLight>(
-		new Motor62CH(),  // First motor (62CH)
-		new Motor9CH(),   // Second motor (9CH)
-		new Motor9CH()    // Third motor (9CH)
-	);
+	myDMXRouteOpId = 0;
+	myDMXRouteCooks = 0;
+	myDMXRoutesByName = false;
+	myDMXRoutesDirty = true;
+	myDMXUnrouted = 0;
+
+	myOutputMode = OutputMode::Channels;
+	myUniverseLayout = UniverseLayout::SlotChannels;
+	myFirstUniverse = 1;
+	myNumUniverses = 0;
+	myPatchFixtures = 0;
+	myPatchStartUniverse = 0;
+	myPatchStartAddress = 0;
+	myPatchDATId = 0;
+	myPatchDATCooks = -1;
+	myCollisionRadius = -1.0f;
+	myCollisionSpacing = -1.0f;
+	myCollisionPairsDirty = true;
+
+	myPoseInputMode = PoseInputMode::Separate;
+	myPackedLayout = PackedLayout::Auto;
+	myPoseLayoutOpId = 0;
+	for (int32_t c = 0; c < NUM_POSE_CHANNELS; c++)
+		myPoseChannelBase[c] = c;
+	myPoseChannelStride = NUM_POSE_CHANNELS;
+	myPackedFixtures = 0;
+	myPoseWarning = nullptr;
+	myPoseInputId = 0;
+	myPoseInputCooks = -1;
+	myPoseInputEnd = 0.0;
+	myTOPWidth = 0;
+	myTOPHeight = 0;
+	myTOPStepX = 0;
+	myTOPStepY = 0;
+
+	myBakeHeader = nullptr;
+	myBakeIndex = nullptr;
+	myBakePlayback = false;
+	myBakePending = false;
+	myBakeFrames = 0;
+	myBakeFramesDone = 0;
+	myBakeCancel = false;
+	myBakeFinished = false;
+	myBakeWritten = false;
+	myPlayByIndex = false;
+	myPlayIndex = 0;
+	myBakeDecodedFrame = -1;
+	myRecordParam = false;
+	myRecordPending = false;
+	myRecordWarning = nullptr;
+
+	myCueMapping = {};
+	myCueTarget = -1;
+	myCueFadeTarget = -1;
+	myCueFade = 1.0f;
+	myCueDATId = 0;
+	myCueDATCooks = -1;
+	myCueFixtures = 0;
+	myCueReload = false;
+	myCueWarning = nullptr;
+
+	myChannelNamesMode = OutputMode::Channels;
+	myChannelNamesLayout = UniverseLayout::SlotChannels;
+	myChannelNamesDirty = true;
+
+	myCookAllocations = 0;
+	myMapping = { 1.0, 0.5, 3.0, 0.5, 3.0, 0.0, 255.0 };
+
+	myFrameCount = 0;
+	myNumSampleMotors = 0;
+	myFeedbackMotors = 0;
+	myFeedbackError = 0.0f;
+	myOutputFeedbackError = 0.0f;
+	myArenaExhausted = false;
+	myOutputArenaExhausted = false;
+	myLayoutChanged = true;
+	myHaveHeldFrame = false;
+	myHeldFrames = 0;
+	myWorkerRunning = false;
+	myAsyncLatency = 1;
+	myAwaitWorker = false;
+	myWorkerQuit = false;
+	myWorkPending = false;
+	myWorkerBusy = false;
+	myCompletedFrame = 0;
 }
 
 CPlusPlusCHOPExample::~CPlusPlusCHOPExample()
 {
-
+	cancelBake();
+	stopWorker();
 }
 
 void
@@ -201,7 +829,11 @@ CPlusPlusCHOPExample::getGeneralInfo(CHOP_GeneralInfo* ginfo, const OP_Inputs* i
 	// getOutputInfo() returns true, and likely also set the info->numSamples to how many
 	// samples you want to generate for this CHOP. Otherwise it'll take on length of the
 	// input CHOP, which may be timesliced.
-	ginfo->timeslice = true;
+	// A universe per channel needs exactly 512 samples, so it can't be timesliced.
+	myOutputMode = static_cast<OutputMode>(inputs->getParInt("Outputmode"));
+	myUniverseLayout = static_cast<UniverseLayout>(inputs->getParInt("Universelayout"));
+	ginfo->timeslice = !(myOutputMode == OutputMode::Universes && myUniverseLayout == UniverseLayout::UniverseChannels);
+	inputs->enablePar("Universelayout", myOutputMode == OutputMode::Universes);
 
 	ginfo->inputMatchIndex = 0;
 }
@@ -209,20 +841,65 @@ CPlusPlusCHOPExample::getGeneralInfo(CHOP_GeneralInfo* ginfo, const OP_Inputs* i
 bool
 CPlusPlusCHOPExample::getOutputInfo(CHOP_OutputInfo* info, const OP_Inputs* inputs, void* reserved1)
 {
+	updateAsync(inputs);
+	updatePatch(inputs);
+	updateCollisionPairs(inputs);
+	updateDMXRoutes(inputs->getInputCHOP(5));
+	updatePoseLayout(inputs);
+	updateCues(inputs);
+
+	size_t arenaBytes = frameArenaBytes(kineticLights.size());
+	if (!myFrameArena.fits(arenaBytes)) {
+		pauseWorker();
+		myFrameArena.reserve(arenaBytes);
+	}
+	if (myLayoutChanged) {
+		pauseWorker();
+		resizeFrames();
+		myLayoutChanged = false;
+	}
+	updateBake(inputs);
+	updateRecord(inputs);
+	updateSender(inputs);
+	updateReceiver(inputs);
+	updateFeedback(inputs);
+
 	// If there is an input connected, we are going to match it's channel names etc
 	// otherwise we'll specify our own.
-	info->numChannels = 80;
-	info->numSamples = 1;
+	if (myOutputMode == OutputMode::Universes) {
+		if (myUniverseLayout == UniverseLayout::UniverseChannels) {
+			info->numChannels = myNumUniverses;
+			info->numSamples = DMX_UNIVERSE_SIZE;
+		}
+		else {
+			info->numChannels = myNumUniverses * DMX_UNIVERSE_SIZE;
+			info->numSamples = 1;
+		}
+	}
+	else {
+		info->numChannels = static_cast<int32_t>(kineticLights.size()) * KineticLight::NUM_SLOTS;
+		info->numSamples = 1;
+	}
 	info->startIndex = 0;
+
+	// A timeslice at the output rate, TouchDesigner works out how many
+	// samples each cook covers
+	bool resample = inputs->getParInt("Resample") != 0;
+	for (const char* name : { "Outputrate", "Resamplefilter", "Antialias" })
+		inputs->enablePar(name, resample);
+	if (resample && inputs->getParDouble("Outputrate") > 0.0 &&
+		!(myOutputMode == OutputMode::Universes && myUniverseLayout == UniverseLayout::UniverseChannels))
+		info->sampleRate = static_cast<float>(inputs->getParDouble("Outputrate"));
+
+	updateChannelNames();
 	return true;
 }
 
 void
 CPlusPlusCHOPExample::getChannelName(int32_t index, OP_String *name, const OP_Inputs* inputs, void* reserved1)
 {
-	char channelName[32];
-	sprintf(channelName, "dmx%d", index + 1);
-	name->setString(channelName);
+	if (index >= 0 && index < (int32_t)myChannelNameOffsets.size())
+		name->setString(&myChannelNames[myChannelNameOffsets[index]]);
 }
 
 void
@@ -231,464 +908,5129 @@ CPlusPlusCHOPExample::execute(CHOP_Output* output,
 							  void* reserved)
 {
 	myExecuteCount++;
+	uint64_t allocationsBefore = threadAllocationCount();
+
+	// A baked show replaces the live pipeline
+	if (myBakePlayback) {
+		bool valid = playBake(inputs->getTimeInfo());
+		outputFrame(output, valid, kineticLights.getSlots(), myUniverses.data());
+		myCookAllocations = threadAllocationCount() - allocationsBefore;
+		assert(myCookAllocations == 0 && "execute() allocated on the heap");
+		return;
+	}
 
-	const OP_CHOPInput* heightInput = inputs->getInputCHOP(0);
-	const OP_CHOPInput* rollInput = inputs->getInputCHOP(1);
-	const OP_CHOPInput* pitchInput = inputs->getInputCHOP(2);
-	const OP_CHOPInput* yawInput = inputs->getInputCHOP(3);
 	const OP_CHOPInput* speedInput = inputs->getInputCHOP(4);
 	const OP_CHOPInput* dmxInput = inputs->getInputCHOP(5);
 
-	// Get parameters
-	double baseSize = inputs->getParDouble("Basesize");
-	double minHeight = inputs->getParDouble("Minheight");
-	double maxHeight = inputs->getParDouble("Maxheight");
-
-	// Get calibration parameters
-	double calMinHeight = inputs->getParDouble("Calibrationminheight");
-	double calMaxHeight = inputs->getParDouble("Calibrationmaxheight");
-	double calMinDMX = inputs->getParDouble("Calibrationmindmxout");
-	double calMaxDMX = inputs->getParDouble("Calibrationmaxdmxout");
-
-	// Get current values from inputs
-	double height = heightInput ? heightInput->getChannelData(0)[0] : minHeight;
-	double roll = rollInput ? rollInput->getChannelData(0)[0] : 0.0;
-	double pitch = pitchInput ? pitchInput->getChannelData(0)[0] : 0.0;
-	double yaw = yawInput ? yawInput->getChannelData(0)[0] : 0.0;
-	double speed = speedInput ? speedInput->getChannelData(0)[0] : 127.0;
-
-
-
-	try {
-
-		// Calculate motor heights
-		std::array<double, 3> motorHeights = calculateMotorHeights(baseSize, roll, pitch, yaw);
+	// Snapshot the inputs. In async mode they're published to the worker,
+	// otherwise the frame is computed right here from the same buffer.
+	FrameInputs& in = myInputFrames.back();
+	uint64_t frame = ++myFrameCount;
+	in.frame = frame;
+	in.elapsed = static_cast<float>(inputs->getTimeInfo()->deltaMS / 1000.0);
+	in.numOutputSamples = output->numSamples;
+	snapshotParameters(inputs, in);
+	myMapping = in.mapping;
+
+	// Get the pose
+	in.planePose = myPoseInputMode == PoseInputMode::Sop || myPoseInputMode == PoseInputMode::Top;
+	in.cuePose = myPoseInputMode == PoseInputMode::Cues;
+	if (myPoseInputMode == PoseInputMode::Sop)
+		snapshotSOPPose(inputs, in);
+	else if (myPoseInputMode == PoseInputMode::Top)
+		snapshotTOPPose(inputs, in);
+	else if (myPoseInputMode == PoseInputMode::Cues)
+		snapshotCuePose(inputs, in);
+	else
+		snapshotCHOPPose(inputs, in, newPoseSamples(inputs), 0);
+
+	// The speed and DMX values go with the newest pose sample
+	in.speed = speedInput && speedInput->numChannels ? newestSample(speedInput, 0) : 127.0;
+
+	// Each motor's newest reported height and when it arrived. A report
+	// can be read by several cooks, the correction only integrates it once.
+	myFeedbackMotors = 0;
+	if (in.feedback.enabled)
+		myFeedbackMotors = myFeedback.read(in.feedbackHeights.data(), in.feedbackFresh.data(), in.feedbackTimes.data(),
+										   in.feedbackHeights.size(), in.feedback.timeout);
+
+	// Additional DMX values, through the routes built in getOutputInfo()
+	if (myDMXRoutesByName && dmxInput) {
+		for (size_t i = 0; i < myDMXRoutes.size(); i++)
+			in.dmxValues[i] = newestSample(dmxInput, myDMXRoutes[i].inputIndex);
+	}
+	else {
+		for (int i = 4; i <= 62; i++)
+			in.dmxValues[i - 4] = dmxInput && (i - 1) < dmxInput->numChannels ? newestSample(dmxInput, i - 1) : 0.0f;
+	}
 
-		if (minHeight >= maxHeight) {
-			throw std::invalid_argument("Minimum height should be less than maximum height.");
+	if (myWorkerRunning) {
+		myInputFrames.publish();
+		{
+			std::lock_guard<std::mutex> lock(myWorkerMutex);
+			myWorkPending = true;
 		}
-		if ((motorHeights[0] < minHeight) && (motorHeights[1] < minHeight) && (motorHeights[2] < minHeight) || (motorHeights[0] > maxHeight) && (motorHeights[1] > maxHeight)&& (motorHeights[2] > maxHeight)) {
-			throw std::out_of_range("Height is out of specified range.");
+		myWorkerWake.notify_one();
+
+		// With no added latency wait for this frame, otherwise take whatever
+		// the worker finished last. Right after the frames reset there is
+		// nothing finished yet, so that cook waits too.
+		if (myAsyncLatency == 0 || myAwaitWorker) {
+			std::unique_lock<std::mutex> lock(myWorkerMutex);
+			myWorkerDone.wait(lock, [&] { return myCompletedFrame >= frame || myWorkerQuit; });
+			myAwaitWorker = false;
 		}
 
-		// Update motor values using KineticLight class
-// First motor (62CH)
-		kineticLight->setMotorChannel(1, 1, heightToDMX(motorHeights[0]+ height , calMinHeight, calMaxHeight, calMinDMX, calMaxDMX));
-		kineticLight->setMotorChannel(1, 2, 0); // Fine-tuning
-		kineticLight->setMotorChannel(1, 3, static_cast<uint8_t>(clamp(speed, 0.0, 255.0)));
+		myOutputFrames.update();
+		const FrameOutput& out = myOutputFrames.front();
+		outputFrame(output, out.valid, out.slots.data(), out.universes.data(), out.sampleMotors.data(), out.numSampleMotors);
+		std::copy(out.limitHits.begin(), out.limitHits.end(), myOutputLimitHits.begin());
+		myOutputFeedbackError = out.feedbackError;
+		myOutputArenaExhausted = out.arenaExhausted;
+	}
+	else {
+		bool valid = computeFrame(in);
+		std::copy(myLimitHits.begin(), myLimitHits.end(), myOutputLimitHits.begin());
+		myOutputFeedbackError = myFeedbackError;
+		myOutputArenaExhausted = myArenaExhausted;
+		outputFrame(output, valid, kineticLights.getSlots(), myUniverses.data(), mySampleMotors.data(), myNumSampleMotors);
+	}
 
-		// Set additional DMX channels for first motor (lighting)
-		for (int i = 4; i <= 62; i++) {
-			int dmxValue = dmxInput && (i - 1) < dmxInput->numChannels ?
-				static_cast<int>(clamp(dmxInput->getChannelData(i - 1)[0], 0.0f, 255.0f)) : 0;
-			kineticLight->setMotorChannel(1, i, dmxValue);
-		}
+	// Everything execute() needs is allocated when the layout changes
+	myCookAllocations = threadAllocationCount() - allocationsBefore;
+	assert(myCookAllocations == 0 && "execute() allocated on the heap");
+}
 
-		// Second motor (9CH)
-		kineticLight->setMotorChannel(2, 1, heightToDMX(motorHeights[1] + height, calMinHeight, calMaxHeight, calMinDMX, calMaxDMX));
-		kineticLight->setMotorChannel(2, 2, 0); // Fine-tuning
-		kineticLight->setMotorChannel(2, 3, static_cast<uint8_t>(clamp(speed, 0.0, 255.0)));
+void
+CPlusPlusCHOPExample::snapshotParameters(const OP_Inputs* inputs, FrameInputs& in)
+{
+	// Get parameters
+	in.mapping.baseSize = inputs->getParDouble("Basesize");
+	in.mapping.minHeight = inputs->getParDouble("Minheight");
+	in.mapping.maxHeight = inputs->getParDouble("Maxheight");
 
-		// Third motor (9CH)
-		kineticLight->setMotorChannel(3, 1, heightToDMX(motorHeights[2] + height, calMinHeight, calMaxHeight, calMinDMX, calMaxDMX));
-		kineticLight->setMotorChannel(3, 2, 0); // Fine-tuning
-		kineticLight->setMotorChannel(3, 3, static_cast<uint8_t>(clamp(speed, 0.0, 255.0)));
+	// Get calibration parameters
+	in.mapping.calMinHeight = inputs->getParDouble("Calibrationminheight");
+	in.mapping.calMaxHeight = inputs->getParDouble("Calibrationmaxheight");
+	in.mapping.calMinDMX = inputs->getParDouble("Calibrationmindmxout");
+	in.mapping.calMaxDMX = inputs->getParDouble("Calibrationmaxdmxout");
+
+	// Get smoothing parameters
+	in.smoothing.mode = static_cast<SmoothMode>(inputs->getParInt("Smoothmode"));
+	in.smoothing.minCutoff = static_cast<float>(inputs->getParDouble("Smoothmincutoff"));
+	in.smoothing.beta = static_cast<float>(inputs->getParDouble("Smoothbeta"));
+	in.smoothing.derivativeCutoff = static_cast<float>(inputs->getParDouble("Smoothderivcutoff"));
+	in.smoothing.springTime = static_cast<float>(inputs->getParDouble("Smoothspringtime"));
+	in.smoothing.cutoff = static_cast<float>(inputs->getParDouble("Smoothcutoff"));
+	in.smoothing.q = static_cast<float>(inputs->getParDouble("Smoothq"));
+
+	// Get prediction parameters
+	in.predictMode = static_cast<PredictMode>(inputs->getParInt("Predictmode"));
+	in.predictLead = static_cast<float>(inputs->getParDouble("Predictlead"));
+	in.kalmanProcessNoise = static_cast<float>(inputs->getParDouble("Kalmanprocessnoise"));
+	in.kalmanMeasurementNoise = static_cast<float>(inputs->getParDouble("Kalmanmeasurementnoise"));
+
+	// Get collision avoidance parameters
+	in.avoidCollisions = inputs->getParInt("Avoidcollisions") != 0;
+	in.fixtureRadius = static_cast<float>(inputs->getParDouble("Fixtureradius"));
+	in.clearance = static_cast<float>(inputs->getParDouble("Clearance"));
+	in.collisionIterations = inputs->getParInt("Collisioniterations");
+
+	// Get safety envelope parameters
+	in.safety.enabled = inputs->getParInt("Safety") != 0;
+	in.safety.minHeight = static_cast<float>(inputs->getParDouble("Safeminheight"));
+	in.safety.maxHeight = static_cast<float>(inputs->getParDouble("Safemaxheight"));
+	in.safety.softKnee = static_cast<float>(inputs->getParDouble("Safeknee"));
+	in.safety.maxSpread = static_cast<float>(inputs->getParDouble("Safemaxspread"));
+	in.safety.maxSpeed = static_cast<float>(inputs->getParDouble("Safemaxspeed"));
+
+	// Get closed loop parameters
+	in.feedback.enabled = inputs->getParInt("Feedback") != 0;
+	in.feedback.kp = static_cast<float>(inputs->getParDouble("Feedbackkp"));
+	in.feedback.ki = static_cast<float>(inputs->getParDouble("Feedbackki"));
+	in.feedback.kd = static_cast<float>(inputs->getParDouble("Feedbackkd"));
+	in.feedback.maxCorrection = static_cast<float>(inputs->getParDouble("Feedbackmax"));
+	in.feedback.timeout = static_cast<float>(inputs->getParDouble("Feedbacktimeout"));
+
+	// Get resampling parameters. Universe channels hold slots, not samples.
+	in.resampling.enabled = inputs->getParInt("Resample") != 0 &&
+		!(myOutputMode == OutputMode::Universes && myUniverseLayout == UniverseLayout::UniverseChannels);
+	in.resampling.rate = static_cast<float>(inputs->getParDouble("Outputrate"));
+	in.resampling.filter = static_cast<ResampleFilter>(inputs->getParInt("Resamplefilter"));
+	in.resampling.antiAlias = inputs->getParInt("Antialias") != 0;
+}
 
+int32_t
+CPlusPlusCHOPExample::newPoseSamples(const OP_Inputs* inputs)
+{
+	// The longest pose input decides which samples are new. A timesliced
+	// input brings the samples since the last cook. An input that isn't
+	// timesliced keeps its samples across cooks, and the filters have seen
+	// all but the newest already, so that one is taken again.
+	const OP_CHOPInput* longest = nullptr;
+	int numInputs = myPoseInputMode == PoseInputMode::Packed ? 1 : NUM_POSE_CHANNELS;
+	for (int c = 0; c < numInputs; c++) {
+		const OP_CHOPInput* input = inputs->getInputCHOP(c);
+		if (input && input->numChannels && (!longest || input->numSamples > longest->numSamples))
+			longest = input;
+	}
+	if (!longest)
+		return 1;
+
+	double end = longest->startIndex + longest->numSamples;
+	int32_t numNew = 1;
+	if (longest->opId == myPoseInputId && longest->totalCooks != myPoseInputCooks && end > myPoseInputEnd)
+		numNew = static_cast<int32_t>(std::min(end - myPoseInputEnd, static_cast<double>(longest->numSamples)));
+	myPoseInputId = longest->opId;
+	myPoseInputCooks = longest->totalCooks;
+	myPoseInputEnd = end;
+	return clamp(numNew, 1, MAX_POSE_SAMPLES);
+}
 
-		// Copy values from KineticLight to output channels
-		for (int i = 0; i < output->numChannels; i++) {
-			float* channel = output->channels[i];
-			if (i < 62) {
-				// First motor channels (1-62)
-				channel[0] = kineticLight->getMotor(1)->getChannel(i + 1);
-			}
-			else if (i >= 62 && i < 71) {
-				// Second motor channels (63-71)
-				channel[0] = kineticLight->getMotor(2)->getChannel(i - 61);
-			}
-			else if (i >= 71 && i < 80) {
-				// Third motor channels (72-80)
-				channel[0] = kineticLight->getMotor(3)->getChannel(i - 70);
-			}
+void
+CPlusPlusCHOPExample::snapshotCHOPPose(const OP_Inputs* inputs, FrameInputs& in, int32_t maxSamples, int32_t back)
+{
+	// Get the pose timeslice from the inputs, aligned on the newest sample.
+	// Channel i of each input drives fixture i and a single channel drives
+	// every fixture. Inputs with a shorter timeslice hold their first sample,
+	// missing inputs and channels hold their default.
+	const OP_CHOPInput* heightInput = inputs->getInputCHOP(0);
+	const OP_CHOPInput* poseInputs[NUM_POSE_CHANNELS] = { heightInput, inputs->getInputCHOP(1), inputs->getInputCHOP(2), inputs->getInputCHOP(3) };
+	const float poseDefaults[NUM_POSE_CHANNELS] = { static_cast<float>(in.mapping.minHeight), 0.0f, 0.0f, 0.0f };
+	if (myPoseInputMode == PoseInputMode::Packed)
+		std::fill(poseInputs, poseInputs + NUM_POSE_CHANNELS, heightInput);
+
+	int32_t numSamples = 1;
+	in.poseSampleRate = static_cast<float>(inputs->getTimeInfo()->rate);
+	for (int c = NUM_POSE_CHANNELS - 1; c >= 0; c--) {
+		if (poseInputs[c] && poseInputs[c]->numChannels) {
+			numSamples = std::max(numSamples, poseInputs[c]->numSamples);
+			in.poseSampleRate = static_cast<float>(poseInputs[c]->sampleRate);
 		}
 	}
-	catch (const std::exception& e) {
-		// Handle errors by setting all channels to 0
-		for (int i = 0; i < output->numChannels; i++) {
-			output->channels[i][0] = 0;
+	numSamples = std::min(numSamples, std::min(maxSamples, MAX_POSE_SAMPLES));
+	in.numPoseSamples = numSamples;
+
+	const size_t numFixtures = kineticLights.size();
+	const size_t rowSize = numFixtures * NUM_POSE_CHANNELS;
+	for (int c = 0; c < NUM_POSE_CHANNELS; c++) {
+		const OP_CHOPInput* poseInput = poseInputs[c];
+		bool connected = poseInput && poseInput->numSamples > 0;
+		int32_t skip = connected ? poseInput->numSamples - numSamples - back : 0;
+
+		// Where fixture f's channel is, and how many fixtures the input holds
+		int32_t base = 0, stride = 1, count = connected ? poseInput->numChannels : 0;
+		if (myPoseInputMode == PoseInputMode::Packed) {
+			base = myPoseChannelBase[c];
+			stride = myPoseChannelStride;
+			count = connected ? myPackedFixtures : 0;
+		}
+
+		for (size_t f = 0; f < numFixtures; f++) {
+			float* dst = in.poseSamples.data() + c * numFixtures + f;
+			int32_t channel = count == 1 ? base : base + static_cast<int32_t>(f) * stride;
+			if (count != 1 && static_cast<int32_t>(f) >= count) {
+				for (int32_t s = 0; s < numSamples; s++)
+					dst[s * rowSize] = poseDefaults[c];
+				continue;
+			}
+			const float* src = poseInput->channelData[channel];
+			for (int32_t s = 0; s < numSamples; s++)
+				dst[s * rowSize] = src[std::max(s + skip, 0)];
 		}
 	}
 }
 
-int32_t
-CPlusPlusCHOPExample::getNumInfoCHOPChans(void * reserved1)
+void
+CPlusPlusCHOPExample::snapshotSOPPose(const OP_Inputs* inputs, FrameInputs& in)
 {
-	// We return the number of channel we want to output to any Info CHOP
-	// connected to the CHOP. In this example we are just going to send one channel.
-	return 2;
+	// One sample per cook. Point i drives fixture i and a single point drives
+	// every fixture; fixtures without a point sit level at the minimum height.
+	in.numPoseSamples = 1;
+	in.poseSampleRate = static_cast<float>(inputs->getTimeInfo()->rate);
+
+	const size_t numFixtures = kineticLights.size();
+	float* heights = in.poseSamples.data() + POSE_HEIGHT * numFixtures;
+	float* normalX = in.poseSamples.data() + POSE_NORMAL_X * numFixtures;
+	float* normalY = in.poseSamples.data() + POSE_NORMAL_Y * numFixtures;
+	float* normalZ = in.poseSamples.data() + POSE_NORMAL_Z * numFixtures;
+	std::fill(heights, heights + numFixtures, static_cast<float>(in.mapping.minHeight));
+	std::fill(normalX, normalX + numFixtures, 0.0f);
+	std::fill(normalY, normalY + numFixtures, 1.0f);
+	std::fill(normalZ, normalZ + numFixtures, 0.0f);
+
+	const OP_SOPInput* sop = inputs->getParSOP("Posesop");
+	int32_t numPoints = sop ? sop->getNumPoints() : 0;
+	if (numPoints < 1)
+		return;
+
+	// Orientation from the named attribute if it holds 3 floats, otherwise
+	// from the point normals, otherwise level
+	const float* orient = nullptr;
+	int32_t orientStride = 3;
+	const char* orientName = inputs->getParString("Orientattrib");
+	if (orientName && orientName[0]) {
+		const SOP_CustomAttribData* attrib = sop->getCustomAttribute(orientName);
+		if (attrib && attrib->attribType == AttribType::Float && attrib->numComponents >= 3 && attrib->floatData) {
+			orient = attrib->floatData;
+			orientStride = attrib->numComponents;
+		}
+	}
+	const SOP_NormalInfo* normals = orient ? nullptr : sop->getNormals();
+	if (normals && normals->attribSet == AttribSet::Point && normals->numNormals >= numPoints && normals->normals)
+		orient = &normals->normals[0].x;
+
+	const Position* positions = sop->getPointPositions();
+	size_t count = numPoints == 1 ? numFixtures : std::min(numFixtures, static_cast<size_t>(numPoints));
+	size_t step = numPoints == 1 ? 0 : 1;
+	for (size_t f = 0; f < count; f++)
+		heights[f] = positions[f * step].y;
+	if (orient) {
+		for (size_t f = 0; f < count; f++) {
+			const float* n = orient + f * step * orientStride;
+			normalX[f] = n[0];
+			normalY[f] = n[1];
+			normalZ[f] = n[2];
+		}
+	}
 }
 
 void
-CPlusPlusCHOPExample::getInfoCHOPChan(int32_t index,
-										OP_InfoCHOPChan* chan,
-										void* reserved1)
+CPlusPlusCHOPExample::snapshotTOPPose(const OP_Inputs* inputs, FrameInputs& in)
 {
-	// This function will be called once for each channel we said we'd want to return
-	// In this example it'll only be called once.
-
-	if (index == 0)
-	{
-		chan->name->setString("executeCount");
-		chan->value = (float)myExecuteCount;
+	// One sample per cook, fixtures level at the minimum height until the
+	// first download arrives
+	in.numPoseSamples = 1;
+	in.poseSampleRate = static_cast<float>(inputs->getTimeInfo()->rate);
+
+	const size_t numFixtures = kineticLights.size();
+	float* heights = in.poseSamples.data() + POSE_HEIGHT * numFixtures;
+	float* normalX = in.poseSamples.data() + POSE_NORMAL_X * numFixtures;
+	float* normalY = in.poseSamples.data() + POSE_NORMAL_Y * numFixtures;
+	float* normalZ = in.poseSamples.data() + POSE_NORMAL_Z * numFixtures;
+	std::fill(heights, heights + numFixtures, static_cast<float>(in.mapping.minHeight));
+	std::fill(normalX, normalX + numFixtures, 0.0f);
+	std::fill(normalY, normalY + numFixtures, 1.0f);
+	std::fill(normalZ, normalZ + numFixtures, 0.0f);
+
+	// Sample last cook's download, which has had a frame to arrive, then
+	// start this cook's
+	const OP_TOPInput* top = inputs->getParTOP("Posetop");
+	const float* texels = nullptr;
+	if (myTOPDownload) {
+		const OP_TextureDesc& desc = myTOPDownload->textureDesc;
+		texels = static_cast<const float*>(myTOPDownload->getData());
+		if (texels && myTOPDownload->size >= uint64_t(desc.width) * desc.height * sizeof(float)) {
+			if (desc.width != myTOPWidth || desc.height != myTOPHeight)
+				updateTOPSampling(desc.width, desc.height);
+		}
+		else
+			texels = nullptr;
 	}
 
-	if (index == 1)
-	{
-		chan->name->setString("offset");
-		chan->value = (float)myOffset;
+	if (texels) {
+		// Height from the bilinear sample. Tilt from the slope across the
+		// sampled texels, scaled from texels to world units by Map Size.
+		const float scale = static_cast<float>(inputs->getParDouble("Heightscale"));
+		const float offset = static_cast<float>(inputs->getParDouble("Heightoffset"));
+		double mapWidth = 0.0, mapDepth = 0.0;
+		inputs->getParDouble2("Mapsize", mapWidth, mapDepth);
+		const bool tilt = inputs->getParInt("Toptilt") != 0;
+		const float slopeX = tilt && myTOPStepX && mapWidth > 0.0 ? scale * myTOPWidth / static_cast<float>(mapWidth) : 0.0f;
+		const float slopeZ = tilt && myTOPStepY && mapDepth > 0.0 ? scale * myTOPHeight / static_cast<float>(mapDepth) : 0.0f;
+		const int32_t stepX = myTOPStepX;
+		const int32_t stepY = myTOPStepY;
+
+		for (size_t f = 0; f < numFixtures; f++) {
+			const float* t = texels + myTOPTexel[f];
+			float fx = myTOPFracX[f];
+			float fy = myTOPFracY[f];
+			float h00 = t[0], h10 = t[stepX], h01 = t[stepY], h11 = t[stepX + stepY];
+			float lower = h00 + (h10 - h00) * fx;
+			float upper = h01 + (h11 - h01) * fx;
+			heights[f] = offset + scale * (lower + (upper - lower) * fy);
+
+			// U runs along +X and V along -Z, so a height rising with V tilts the normal towards +Z
+			normalX[f] = -slopeX * ((h10 - h00) + ((h11 - h01) - (h10 - h00)) * fy);
+			normalZ[f] = slopeZ * ((h01 - h00) + ((h11 - h10) - (h01 - h00)) * fx);
+		}
+	}
+	if (texels)
+		myPoseWarning = nullptr;
+	else if (top && myTOPDownload)
+		myPoseWarning = "Pose TOP download could not be read as 32-bit float.";
+
+	myTOPDownload.release();
+	if (top) {
+		OP_TOPInputDownloadOptions options;
+		options.pixelFormat = OP_PixelFormat::Mono32Float;
+		myTOPDownload = top->downloadTexture(options, nullptr);
 	}
-}
-
-bool		
-CPlusPlusCHOPExample::getInfoDATSize(OP_InfoDATSize* infoSize, void* reserved1)
-{
-	infoSize->rows = 2;
-	infoSize->cols = 2;
-	// Setting this to false means we'll be assigning values to the table
-	// one row at a time. True means we'll do it one column at a time.
-	infoSize->byColumn = false;
-	return true;
 }
 
 void
-CPlusPlusCHOPExample::getInfoDATEntries(int32_t index,
-										int32_t nEntries,
-										OP_InfoDATEntries* entries, 
-										void* reserved1)
+CPlusPlusCHOPExample::snapshotCuePose(const OP_Inputs* inputs, FrameInputs& in)
 {
-	char tempBuffer[4096];
-
-	if (index == 0)
-	{
-		// Set the value for the first column
-		entries->values[0]->setString("executeCount");
+	// Cue motor values are recomputed the first time each cue is used after
+	// the mapping changes
+	if (memcmp(&in.mapping, &myCueMapping, sizeof(MotorMapping))) {
+		myCueMapping = in.mapping;
+		for (Cue& cue : myCues)
+			cue.computed = false;
+	}
 
-		// Set the value for the second column
-#ifdef _WIN32
-		sprintf_s(tempBuffer, "%d", myExecuteCount);
-#else // macOS
-		snprintf(tempBuffer, sizeof(tempBuffer), "%d", myExecuteCount);
-#endif
-		entries->values[1]->setString(tempBuffer);
+	// A new target fades in from wherever the last fade got to
+	if (myCueTarget != myCueFadeTarget) {
+		std::copy(myCueBlend.begin(), myCueBlend.end(), myCueFrom.begin());
+		std::copy(myCueBlendValid.begin(), myCueBlendValid.end(), myCueFromValid.begin());
+		std::copy(myCueBlendOrientation.begin(), myCueBlendOrientation.end(), myCueFromOrientation.begin());
+		myCueFadeTarget = myCueTarget;
+		myCueFade = 0.0f;
+		if (myCueTarget >= 0) {
+			Cue& cue = myCues[myCueTarget];
+			if (!cue.computed)
+				computeCue(cue, in.mapping);
+			prepareSlerp(myCueFromOrientation.data(), cue.orientation.data(), myCueFixtures, myCueSlerpAngle.data());
+		}
 	}
 
-	if (index == 1)
-	{
-		// Set the value for the first column
-		entries->values[0]->setString("offset");
+	if (myCueTarget >= 0) {
+		Cue& cue = myCues[myCueTarget];
+		if (!cue.computed)
+			computeCue(cue, in.mapping);
+
+		double fadeTime = inputs->getParDouble("Cuefade");
+		double elapsed = inputs->getTimeInfo()->deltaMS / 1000.0;
+		myCueFade = fadeTime > 0.0 ? std::min(1.0f, myCueFade + static_cast<float>(elapsed / fadeTime)) : 1.0f;
+
+		// Lerp the motor values in 16 bit fixed point, no trig involved
+		const uint32_t weight = static_cast<uint32_t>(myCueFade * 65536.0f + 0.5f);
+		const uint16_t* from = myCueFrom.data();
+		const uint16_t* to = cue.motors.data();
+		uint16_t* blend = myCueBlend.data();
+		for (size_t i = 0, n = myCueBlend.size(); i < n; i++)
+			blend[i] = static_cast<uint16_t>((from[i] * (65536 - weight) + to[i] * weight + 32768) >> 16);
+
+		// The orientation is followed in either mode, so a fade can start from
+		// it after the mode changes
+		bool fading = weight < 65536;
+		if (fading)
+			slerpOrientations(myCueFromOrientation.data(), cue.orientation.data(), myCueSlerpAngle.data(), myCueFade, myCueFixtures, myCueBlendOrientation.data());
+		else
+			std::copy(cue.orientation.begin(), cue.orientation.end(), myCueBlendOrientation.begin());
+
+		// Fixtures in range at both ends take the motor values of the slerped
+		// orientation instead, a block at a time like computeCue()
+		if (fading && static_cast<CueFadeMode>(inputs->getParInt("Cuefademode")) == CueFadeMode::Orientation) {
+			const size_t block = 256;
+			float motorHeights[block * 3];
+			uint16_t motors[block * 3];
+			bool valid[block];
+			const size_t count = myCueFixtures;
+			const float* orientation = myCueBlendOrientation.data();
+			for (size_t first = 0; first < count; first += block) {
+				size_t n = std::min(block, count - first);
+				calculateQuaternionMotorHeights(in.mapping.baseSize, orientation + ORIENT_W * count + first, orientation + ORIENT_X * count + first,
+												orientation + ORIENT_Y * count + first, orientation + ORIENT_Z * count + first, n, motorHeights);
+				mapMotorHeights16(in.mapping, orientation + ORIENT_HEIGHT * count + first, 1, motorHeights, n, motors, valid);
+				for (size_t f = 0; f < n; f++) {
+					if (myCueFromValid[first + f] && cue.valid[first + f])
+						std::copy(motors + f * 3, motors + f * 3 + 3, blend + (first + f) * 3);
+				}
+			}
+		}
 
-		// Set the value for the second column
-#ifdef _WIN32
-		sprintf_s(tempBuffer, "%g", myOffset);
-#else // macOS
-		snprintf(tempBuffer, sizeof(tempBuffer), "%g", myOffset);
-#endif
-		entries->values[1]->setString( tempBuffer);
+		// Fixtures in range at either end stay on for the fade
+		for (size_t f = 0; f < myCueBlendValid.size(); f++)
+			myCueBlendValid[f] = fading ? (myCueFromValid[f] | cue.valid[f]) : cue.valid[f];
 	}
+
+	std::copy(myCueBlend.begin(), myCueBlend.end(), in.cueMotors.begin());
+	std::copy(myCueBlendValid.begin(), myCueBlendValid.end(), in.cueValid.begin());
+	in.cueFine = inputs->getParInt("Cuefine") != 0;
 }
 
 void
-CPlusPlusCHOPExample::buildDynamicMenu(const OP_Inputs* inputs, OP_BuildDynamicMenuInfo* info, void* reserved1)
+CPlusPlusCHOPExample::computeCue(Cue& cue, const MotorMapping& mapping)
 {
-
+	// A block of fixtures at a time, with scratch on the stack like solvePoses().
+	// Fixtures the cue doesn't list sit at the minimum height.
+	const size_t block = 256;
+	float motorHeights[block * 3];
+	float fixtureHeights[block];
+	bool valid[block];
+	size_t count = cue.valid.size();
+	for (size_t first = 0; first < count; first += block) {
+		size_t n = std::min(block, count - first);
+		const float* pose = cue.pose.data() + first * NUM_POSE_CHANNELS;
+		for (size_t f = 0; f < n; f++) {
+			float height = pose[f * NUM_POSE_CHANNELS + POSE_HEIGHT];
+			fixtureHeights[f] = std::isnan(height) ? static_cast<float>(mapping.minHeight) : height;
+		}
+		calculateRotationMotorHeights(mapping.baseSize, pose + POSE_ROLL, pose + POSE_PITCH, pose + POSE_YAW, n, NUM_POSE_CHANNELS, motorHeights);
+		mapMotorHeights16(mapping, fixtureHeights, 1, motorHeights, n, cue.motors.data() + first * 3, valid);
+
+		float* orientation = cue.orientation.data() + first;
+		rotationToQuaternions(pose + POSE_ROLL, pose + POSE_PITCH, pose + POSE_YAW, n, NUM_POSE_CHANNELS, orientation + ORIENT_W * count,
+							  orientation + ORIENT_X * count, orientation + ORIENT_Y * count, orientation + ORIENT_Z * count);
+		std::copy(fixtureHeights, fixtureHeights + n, orientation + ORIENT_HEIGHT * count);
+		for (size_t f = 0; f < n; f++) {
+			cue.valid[first + f] = valid[f];
+			if (!valid[f])
+				std::fill(cue.motors.begin() + (first + f) * 3, cue.motors.begin() + (first + f) * 3 + 3, uint16_t(0));
+		}
+	}
+	cue.computed = true;
 }
 
 void
-CPlusPlusCHOPExample::setupParameters(OP_ParameterManager* manager, void *reserved1)
+CPlusPlusCHOPExample::updateTOPSampling(uint32_t width, uint32_t height)
 {
-	
-
-
-	
+	myTOPWidth = width;
+	myTOPHeight = height;
+	myTOPStepX = width > 1 ? 1 : 0;
+	myTOPStepY = height > 1 ? static_cast<int32_t>(width) : 0;
+
+	// Texel centers sit at half texel offsets, the UVs are clamped to the edge texels
+	for (size_t f = 0; f < myPatch.size() && f < myTOPTexel.size(); f++) {
+		float x = clamp(myPatch[f].u * width - 0.5f, 0.0f, static_cast<float>(width - 1));
+		float y = clamp(myPatch[f].v * height - 0.5f, 0.0f, static_cast<float>(height - 1));
+		int32_t x0 = std::min(static_cast<int32_t>(x), std::max(static_cast<int32_t>(width) - 2, 0));
+		int32_t y0 = std::min(static_cast<int32_t>(y), std::max(static_cast<int32_t>(height) - 2, 0));
+		myTOPTexel[f] = y0 * static_cast<int32_t>(width) + x0;
+		myTOPFracX[f] = x - x0;
+		myTOPFracY[f] = y - y0;
+	}
+}
 
+void
+CPlusPlusCHOPExample::solvePoses(const float* poses, size_t count, bool planes, float* motorHeights, uint8_t* motorDMX) const
+{
+	if (planes)
+		calculatePlaneMotorHeights(myMapping.baseSize, poses + POSE_NORMAL_X, poses + POSE_NORMAL_Y, poses + POSE_NORMAL_Z, count, NUM_POSE_CHANNELS, motorHeights);
+	else
+		calculateRotationMotorHeights(myMapping.baseSize, poses + POSE_ROLL, poses + POSE_PITCH, poses + POSE_YAW, count, NUM_POSE_CHANNELS, motorHeights);
+
+	// Validity flags go in a small stack buffer, a block of fixtures at a time
+	const size_t block = 256;
+	bool valid[block];
+	for (size_t first = 0; first < count; first += block) {
+		size_t n = std::min(block, count - first);
+		mapMotorHeights(myMapping, poses + first * NUM_POSE_CHANNELS + POSE_HEIGHT, NUM_POSE_CHANNELS, motorHeights + first * 3, n, motorDMX + first * 3, valid);
+		for (size_t f = 0; f < n; f++) {
+			if (!valid[f])
+				std::fill(motorDMX + (first + f) * 3, motorDMX + (first + f) * 3 + 3, uint8_t(0));
+		}
+	}
+}
 
+bool
+CPlusPlusCHOPExample::computeFrame(const FrameInputs& in)
+{
+	myFrameArena.reset();
+	myArenaExhausted = false;
+
+	// Invalid ranges zero the output
+	if (!(in.mapping.minHeight < in.mapping.maxHeight))
+		return false;
+
+	// Scratch memory for this frame, taken from the frame arena. Running out
+	// leaves the frame uncomputed, so the last valid one is held.
+	size_t numFixtures = kineticLights.size();
+	size_t numPoseChannels = numFixtures * NUM_POSE_CHANNELS;
+	float* smoothed = myFrameArena.alloc<float>(static_cast<size_t>(in.numPoseSamples) * numPoseChannels);
+	float* pose = myFrameArena.alloc<float>(numPoseChannels);
+	float* motorHeights = myFrameArena.alloc<float>(numFixtures * 3);
+	uint8_t* motorDMX = myFrameArena.alloc<uint8_t>(numFixtures * 3);
+	uint8_t* motorFine = myFrameArena.alloc<uint8_t>(numFixtures * 3);
+	bool* fixtureValid = myFrameArena.alloc<bool>(numFixtures);
+	if (!smoothed || !pose || !motorHeights || !motorDMX || !motorFine || !fixtureValid) {
+		myArenaExhausted = true;
+		return false;
+	}
+	std::fill(myLimitHits.begin(), myLimitHits.end(), uint8_t(0));
+	myFeedbackError = 0.0f;
+	myNumSampleMotors = 0;
+
+	if (in.cuePose) {
+		// Cues come with their motor values already blended. The feedback
+		// correction and the safety envelope take them back to heights
+		// through the calibration, in the same order as for live poses.
+		const uint16_t* cueMotors = in.cueMotors.data();
+		if ((in.safety.enabled || in.feedback.enabled) && in.mapping.calMaxDMX > in.mapping.calMinDMX) {
+			uint16_t* limited = myFrameArena.alloc<uint16_t>(numFixtures * 3);
+			if (!limited) {
+				myArenaExhausted = true;
+				return false;
+			}
+			const float heightPerDMX = static_cast<float>((in.mapping.calMaxHeight - in.mapping.calMinHeight) / (in.mapping.calMaxDMX - in.mapping.calMinDMX));
+			for (size_t i = 0; i < numFixtures * 3; i++)
+				motorHeights[i] = static_cast<float>(in.mapping.calMinHeight) + (cueMotors[i] / 256.0f - static_cast<float>(in.mapping.calMinDMX)) * heightPerDMX;
+			if (in.feedback.enabled)
+				myFeedbackError = myCorrector.process(motorHeights, in.feedbackHeights.data(), in.feedbackFresh.data(),
+													  in.feedbackTimes.data(), numFixtures * 3, in.elapsed, in.feedback);
+			if (in.safety.enabled)
+				mySafety.process(motorHeights, numFixtures, in.elapsed, in.safety, myLimitHits.data());
+			const float zero = 0.0f;
+			mapMotorHeights16(in.mapping, &zero, 0, motorHeights, numFixtures, limited, fixtureValid);
+			cueMotors = limited;
+		}
+		for (size_t i = 0; i < numFixtures * 3; i++) {
+			uint32_t value = cueMotors[i];
+			motorDMX[i] = static_cast<uint8_t>(in.cueFine ? value >> 8 : std::min<uint32_t>((value + 128) >> 8, 255));
+			motorFine[i] = static_cast<uint8_t>(in.cueFine ? value & 0xFF : 0);
+		}
+		for (size_t f = 0; f < numFixtures; f++)
+			fixtureValid[f] = in.cueValid[f] != 0;
+	}
+	else {
+		// Smooth the pose timeslice, then take its newest sample extrapolated by the prediction lead
+		float dt = in.poseSampleRate > 0.0f ? 1.0f / in.poseSampleRate : 0.0f;
+		mySmoother.process(in.poseSamples.data(), in.numPoseSamples, dt, in.smoothing, smoothed);
+		myPredictor.process(smoothed, in.numPoseSamples, dt, in.predictLead, in.predictMode,
+							in.kalmanProcessNoise, in.kalmanMeasurementNoise, pose);
+
+		// When resampling, each output sample's pose is interpolated from the
+		// smoothed timeslice, moved ahead by the prediction of the newest
+		// sample. The samples before the newest only keep their motor values.
+		int32_t numSamples = 1;
+		if (in.resampling.enabled && in.resampling.rate > 0.0f && in.numPoseSamples > 0) {
+			numSamples = clamp(in.numOutputSamples, 1, MAX_OUTPUT_SAMPLES);
+			float* samplePose = myFrameArena.alloc<float>(numPoseChannels);
+			float* lead = myFrameArena.alloc<float>(numPoseChannels);
+			if (!samplePose || !lead) {
+				myArenaExhausted = true;
+				return false;
+			}
+
+			const float* newest = smoothed + static_cast<size_t>(in.numPoseSamples - 1) * numPoseChannels;
+			for (size_t c = 0; c < numPoseChannels; c++)
+				lead[c] = pose[c] - newest[c];
+
+			float step = in.poseSampleRate > 0.0f ? in.poseSampleRate / in.resampling.rate : 0.0f;
+			float scale = in.resampling.antiAlias ? std::max(step, 1.0f) : 1.0f;
+			for (int32_t s = 0; s < numSamples; s++) {
+				float position = (in.numPoseSamples - 1) - (numSamples - 1 - s) * step;
+				float* target = s == numSamples - 1 ? pose : samplePose;
+				resampleRows(smoothed, in.numPoseSamples, numPoseChannels, position, scale, in.resampling.filter, target);
+				for (size_t c = 0; c < numPoseChannels; c++)
+					target[c] += lead[c];
+				if (target == pose)
+					break;
+
+				solveMotors(in, samplePose, in.elapsed / numSamples, motorHeights, motorDMX, fixtureValid);
+				uint8_t* sample = mySampleMotors.data() + static_cast<size_t>(s) * numFixtures * 3;
+				for (size_t f = 0; f < numFixtures; f++) {
+					for (int m = 0; m < 3; m++)
+						sample[f * 3 + m] = fixtureValid[f] ? motorDMX[f * 3 + m] : 0;
+				}
+			}
+			myNumSampleMotors = numSamples - 1;
+		}
+
+		solveMotors(in, pose, in.elapsed / numSamples, motorHeights, motorDMX, fixtureValid);
+		memset(motorFine, 0, numFixtures * 3);
+	}
+
+	uint8_t speedDMX = static_cast<uint8_t>(clamp(in.speed, 0.0, 255.0));
+
+	// Update motor values using KineticLight class
+	for (size_t f = 0; f < numFixtures; f++) {
+		KineticLight* kineticLight = kineticLights[f];
+
+		// First motor (62CH)
+		kineticLight->setMotorChannel(1, 1, motorDMX[f * 3 + 0]);
+		kineticLight->setMotorChannel(1, 2, motorFine[f * 3 + 0]); // Fine-tuning
+		kineticLight->setMotorChannel(1, 3, speedDMX);
+
+		// Second motor (9CH)
+		kineticLight->setMotorChannel(2, 1, motorDMX[f * 3 + 1]);
+		kineticLight->setMotorChannel(2, 2, motorFine[f * 3 + 1]); // Fine-tuning
+		kineticLight->setMotorChannel(2, 3, speedDMX);
+
+		// Third motor (9CH)
+		kineticLight->setMotorChannel(3, 1, motorDMX[f * 3 + 2]);
+		kineticLight->setMotorChannel(3, 2, motorFine[f * 3 + 2]); // Fine-tuning
+		kineticLight->setMotorChannel(3, 3, speedDMX);
+	}
+
+	// Set additional DMX channels (lighting)
+	if (myDMXRoutesByName) {
+		for (size_t i = 0; i < myDMXRoutes.size(); i++) {
+			const DMXRoute& route = myDMXRoutes[i];
+			kineticLights[route.fixture]->setSlot(route.slot, static_cast<uint8_t>(clamp(in.dmxValues[i], 0.0f, 255.0f)));
+		}
+	}
+	else if (numFixtures) {
+		for (int i = 4; i <= 62; i++)
+			kineticLights[0]->setMotorChannel(1, i, static_cast<uint8_t>(clamp(in.dmxValues[i - 4], 0.0f, 255.0f)));
+	}
+
+	for (size_t f = 0; f < numFixtures; f++) {
+		if (fixtureValid[f])
+			continue;
+		for (int slot = 1; slot <= KineticLight::NUM_SLOTS; slot++)
+			kineticLights[f]->setSlot(slot, 0);
+	}
+
+	packUniverses();
+	return true;
+}
+
+void
+CPlusPlusCHOPExample::solveMotors(const FrameInputs& in, float* pose, float elapsed, float* motorHeights, uint8_t* motorDMX, bool* fixtureValid)
+{
+	// Calculate motor heights relative to each fixture's height, then map
+	// them to DMX. A fixture whose motors are all out of range is zeroed.
+	size_t numFixtures = kineticLights.size();
+	const float* p[NUM_POSE_CHANNELS];
+	for (int c = 0; c < NUM_POSE_CHANNELS; c++)
+		p[c] = pose + c * numFixtures;
+	if (in.planePose)
+		calculatePlaneMotorHeights(in.mapping.baseSize, p[POSE_NORMAL_X], p[POSE_NORMAL_Y], p[POSE_NORMAL_Z], numFixtures, 1, motorHeights);
+	else
+		calculateRotationMotorHeights(in.mapping.baseSize, p[POSE_ROLL], p[POSE_PITCH], p[POSE_YAW], numFixtures, 1, motorHeights);
+	if (in.avoidCollisions)
+		avoidCollisions(in, pose + POSE_HEIGHT * numFixtures, motorHeights);
+	if (in.safety.enabled || in.feedback.enabled) {
+		// The feedback correction and the envelope work on absolute motor
+		// heights. The envelope comes last, so corrections stay inside it.
+		const float* heights = p[POSE_HEIGHT];
+		for (size_t f = 0; f < numFixtures; f++) {
+			for (int m = 0; m < 3; m++)
+				motorHeights[f * 3 + m] += heights[f];
+		}
+		if (in.feedback.enabled)
+			myFeedbackError = myCorrector.process(motorHeights, in.feedbackHeights.data(), in.feedbackFresh.data(),
+												  in.feedbackTimes.data(), numFixtures * 3, elapsed, in.feedback);
+		if (in.safety.enabled)
+			mySafety.process(motorHeights, numFixtures, elapsed, in.safety, myLimitHits.data());
+		for (size_t f = 0; f < numFixtures; f++) {
+			for (int m = 0; m < 3; m++)
+				motorHeights[f * 3 + m] -= heights[f];
+		}
+	}
+	mapMotorHeights(in.mapping, p[POSE_HEIGHT], 1, motorHeights, numFixtures, motorDMX, fixtureValid);
+}
+
+void
+CPlusPlusCHOPExample::writeOutput(CHOP_Output* output, bool valid, const uint8_t* slots, const uint8_t* universes,
+								  const uint8_t* sampleMotors, int32_t numSampleMotors)
+{
+	if (!valid) {
+		// Handle errors by setting all channels to 0
+		for (int i = 0; i < output->numChannels; i++) {
+			for (int j = 0; j < output->numSamples; j++)
+				output->channels[i][j] = 0;
+		}
+	}
+	else if (myOutputMode == OutputMode::Universes) {
+		// Copy the universe buffer to the output channels
+		int numUniverseSlots = myNumUniverses * DMX_UNIVERSE_SIZE;
+		if (myUniverseLayout == UniverseLayout::UniverseChannels) {
+			for (int i = 0; i < output->numChannels && i < myNumUniverses; i++) {
+				const uint8_t* universe = &universes[i * DMX_UNIVERSE_SIZE];
+				for (int j = 0; j < output->numSamples && j < DMX_UNIVERSE_SIZE; j++)
+					output->channels[i][j] = universe[j];
+			}
+		}
+		else {
+			for (int i = 0; i < output->numChannels && i < numUniverseSlots; i++) {
+				for (int j = 0; j < output->numSamples; j++)
+					output->channels[i][j] = universes[i];
+			}
+		}
+	}
+	else {
+		// Copy values from the fixtures' slots to output channels
+		int numSlots = static_cast<int>(kineticLights.size()) * KineticLight::NUM_SLOTS;
+		for (int i = 0; i < output->numChannels; i++) {
+			float value = i < numSlots ? static_cast<float>(slots[i]) : 0.0f;
+			for (int j = 0; j < output->numSamples; j++)
+				output->channels[i][j] = value;
+		}
+	}
+
+	// Resampled motor heights of the samples before the newest, wherever the
+	// motors' height slots are in the output. Output samples older than the
+	// computed ones hold the oldest.
+	if (!valid || numSampleMotors <= 0 || output->numSamples < 2 ||
+		(myOutputMode == OutputMode::Universes && myUniverseLayout == UniverseLayout::UniverseChannels))
+		return;
+	int32_t numFixtures = static_cast<int32_t>(kineticLights.size());
+	for (int32_t f = 0; f < numFixtures && f < (int32_t)myPatch.size(); f++) {
+		int32_t base = f * KineticLight::NUM_SLOTS;
+		if (myOutputMode == OutputMode::Universes) {
+			int32_t universe = myPatch[f].universe - myFirstUniverse;
+			if (universe < 0 || universe >= myNumUniverses)
+				continue;
+			base = universe * DMX_UNIVERSE_SIZE + myPatch[f].address - 1;
+		}
+		for (int m = 0; m < 3; m++) {
+			int32_t channel = base + KineticLight::motorSlot(m + 1) - 1;
+			if (channel >= output->numChannels)
+				continue;
+			for (int32_t j = 0; j < output->numSamples - 1; j++) {
+				int32_t sample = std::max(numSampleMotors - (output->numSamples - 1 - j), 0);
+				output->channels[channel][j] = sampleMotors[(static_cast<size_t>(sample) * numFixtures + f) * 3 + m];
+			}
+		}
+	}
+}
+
+void
+CPlusPlusCHOPExample::outputFrame(CHOP_Output* output, bool valid, const uint8_t* slots, const uint8_t* universes,
+								  const uint8_t* sampleMotors, int32_t numSampleMotors)
+{
+	if (valid) {
+		memcpy(myHeldSlots.data(), slots, myHeldSlots.size());
+		if (!myHeldUniverses.empty())
+			memcpy(myHeldUniverses.data(), universes, myHeldUniverses.size());
+		myHaveHeldFrame = true;
+	}
+	else if (myHaveHeldFrame) {
+		// Hold the motors where they are rather than dropping them to 0
+		valid = true;
+		slots = myHeldSlots.data();
+		universes = myHeldUniverses.data();
+		numSampleMotors = 0;
+		myHeldFrames++;
+	}
+
+	writeOutput(output, valid, slots, universes, sampleMotors, numSampleMotors);
+	myRecorder.push(valid ? slots : nullptr);
+	if (valid)
+		mySender.publish(universes);
+}
+
+void
+CPlusPlusCHOPExample::updateAsync(const OP_Inputs* inputs)
+{
+	bool async = inputs->getParInt("Async") != 0;
+	myAsyncLatency = inputs->getParInt("Asynclatency");
+	inputs->enablePar("Asynclatency", async);
+
+	if (async && !myWorkerRunning)
+		startWorker();
+	else if (!async && myWorkerRunning)
+		stopWorker();
+}
+
+void
+CPlusPlusCHOPExample::startWorker()
+{
+	myWorkerQuit = false;
+	myWorkPending = false;
+	myWorkerBusy = false;
+	myCompletedFrame = 0;
+	myLayoutChanged = true;
+	myWorker = std::thread(&CPlusPlusCHOPExample::workerLoop, this);
+	myWorkerRunning = true;
+}
+
+void
+CPlusPlusCHOPExample::stopWorker()
+{
+	if (!myWorkerRunning)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(myWorkerMutex);
+		myWorkerQuit = true;
+	}
+	myWorkerWake.notify_one();
+	myWorker.join();
+	myWorkerRunning = false;
+}
+
+void
+CPlusPlusCHOPExample::pauseWorker()
+{
+	if (!myWorkerRunning)
+		return;
+	std::unique_lock<std::mutex> lock(myWorkerMutex);
+	myWorkPending = false;
+	myWorkerDone.wait(lock, [this] { return !myWorkerBusy; });
+}
+
+void
+CPlusPlusCHOPExample::workerLoop()
+{
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(myWorkerMutex);
+			myWorkerWake.wait(lock, [this] { return myWorkPending || myWorkerQuit; });
+			if (myWorkerQuit)
+				return;
+			myWorkPending = false;
+			myWorkerBusy = true;
+		}
+
+		uint64_t allocationsBefore = threadAllocationCount();
+		uint64_t frame = 0;
+		if (myInputFrames.update()) {
+			const FrameInputs& in = myInputFrames.front();
+			FrameOutput& out = myOutputFrames.back();
+			out.frame = frame = in.frame;
+			out.valid = computeFrame(in);
+			if (out.valid) {
+				memcpy(out.slots.data(), kineticLights.getSlots(), out.slots.size());
+				if (!out.universes.empty())
+					memcpy(out.universes.data(), myUniverses.data(), out.universes.size());
+			}
+			std::copy(myLimitHits.begin(), myLimitHits.end(), out.limitHits.begin());
+			out.feedbackError = myFeedbackError;
+			out.arenaExhausted = myArenaExhausted;
+			out.numSampleMotors = myNumSampleMotors;
+			memcpy(out.sampleMotors.data(), mySampleMotors.data(), static_cast<size_t>(myNumSampleMotors) * kineticLights.size() * 3);
+			myOutputFrames.publish();
+		}
+		assert(threadAllocationCount() == allocationsBefore && "async frame allocated on the heap");
+
+		{
+			std::lock_guard<std::mutex> lock(myWorkerMutex);
+			myWorkerBusy = false;
+			if (frame)
+				myCompletedFrame = frame;
+		}
+		myWorkerDone.notify_all();
+	}
+}
+
+void
+CPlusPlusCHOPExample::resizeFrames()
+{
+	size_t numDMXValues = std::max<size_t>(myDMXRoutes.size(), 62 - 4 + 1);
+	for (int i = 0; i < 3; i++) {
+		myInputFrames[i].frame = 0;
+		myInputFrames[i].dmxValues.assign(numDMXValues, 0.0f);
+		myInputFrames[i].poseSamples.assign(MAX_POSE_SAMPLES * NUM_POSE_CHANNELS * kineticLights.size(), 0.0f);
+		myInputFrames[i].numPoseSamples = 0;
+		myInputFrames[i].cuePose = false;
+		myInputFrames[i].cueMotors.assign(kineticLights.size() * 3, 0);
+		myInputFrames[i].cueValid.assign(kineticLights.size(), 0);
+		myInputFrames[i].feedbackHeights.assign(kineticLights.size() * 3, 0.0f);
+		myInputFrames[i].feedbackFresh.assign(kineticLights.size() * 3, 0.0f);
+		myInputFrames[i].feedbackTimes.assign(kineticLights.size() * 3, 0);
+		myInputFrames[i].numOutputSamples = 1;
+
+		FrameOutput& out = myOutputFrames[i];
+		out.frame = 0;
+		out.valid = false;
+		out.slots.assign(kineticLights.size() * KineticLight::NUM_SLOTS, 0);
+		out.universes.assign(myUniverses.size(), 0);
+		out.limitHits.assign(kineticLights.size(), 0);
+		out.feedbackError = 0.0f;
+		out.arenaExhausted = false;
+		out.sampleMotors.assign((MAX_OUTPUT_SAMPLES - 1) * kineticLights.size() * 3, 0);
+		out.numSampleMotors = 0;
+	}
+	myInputFrames.reset();
+	myOutputFrames.reset();
+	myAwaitWorker = myWorkerRunning;
+	if (myHeldSlots.size() != kineticLights.size() * KineticLight::NUM_SLOTS || myHeldUniverses.size() != myUniverses.size()) {
+		myHeldSlots.assign(kineticLights.size() * KineticLight::NUM_SLOTS, 0);
+		myHeldUniverses.assign(myUniverses.size(), 0);
+		myHaveHeldFrame = false;
+	}
+	myTOPTexel.assign(kineticLights.size(), 0);
+	myTOPFracX.assign(kineticLights.size(), 0.0f);
+	myTOPFracY.assign(kineticLights.size(), 0.0f);
+	myTOPWidth = myTOPHeight = 0;
+
+	mySmoother.resize(NUM_POSE_CHANNELS * kineticLights.size());
+	myPredictor.resize(NUM_POSE_CHANNELS * kineticLights.size());
+	mySafety.resize(kineticLights.size());
+	myCorrector.resize(kineticLights.size() * 3);
+	myLimitHits.assign(kineticLights.size(), 0);
+	myOutputLimitHits.assign(kineticLights.size(), 0);
+	mySampleMotors.assign((MAX_OUTPUT_SAMPLES - 1) * kineticLights.size() * 3, 0);
+	myNumSampleMotors = 0;
+	myBakeDecodedFrame = -1;
+}
+
+void
+CPlusPlusCHOPExample::updateBake(const OP_Inputs* inputs)
+{
+	const char* path = inputs->getParFilePath("Bakefile");
+	if (!path)
+		path = "";
+
+	bool playback = inputs->getParInt("Bakeplay") != 0;
+	if (!playback && myBakePlayback) {
+		closeBake();
+		myBakeWarning.clear();
+		memset(kineticLights.getSlots(), 0, kineticLights.size() * KineticLight::NUM_SLOTS);
+	}
+
+	// A finished bake is collected here; its file is mapped below if it's
+	// playing. Another Bake Show pulse restarts a bake still running.
+	if (myBakeFinished)
+		finishBake();
+	if (myBakePending) {
+		myBakePending = false;
+		if (!*path)
+			myBakeWarning = "Set a Bake File to bake the show to";
+		else {
+			cancelBake();
+			bakeShow(inputs, path);
+		}
+	}
+
+	myPlayByIndex = inputs->getParInt("Playkey") == 1;
+	myPlayIndex = inputs->getParInt("Playindex");
+	inputs->enablePar("Playindex", myPlayByIndex);
+
+	// A new file, or one just rebaked, is mapped again. A file that's still
+	// being recorded or baked is mapped once it's finished.
+	bool recording = myRecorder.isWriting() && myRecorder.getPath() == path;
+	bool baking = myBakeThread.joinable() && myBakingPath == path;
+	if (playback && myBakePath != path && !recording && !baking) {
+		// The worker stays idle while a baked show plays, it owns the
+		// fixtures' slots otherwise
+		pauseWorker();
+		closeBake();
+		if (*path)
+			openBake(path);
+		myBakePath = path;
+	}
+	myBakePlayback = playback;
+}
+
+void
+CPlusPlusCHOPExample::updateRecord(const OP_Inputs* inputs)
+{
+	const char* path = inputs->getParFilePath("Recordfile");
+	if (!path)
+		path = "";
+
+	bool record = inputs->getParInt("Record") != 0;
+	if (record && !myRecordParam) {
+		myRecordPending = true;
+		myRecordWarning = nullptr;
+	}
+	myRecordParam = record;
+
+	// A fixture count change stops the recording, since it changes the size
+	// of every frame
+	if (myRecorder.isRecording() && !record)
+		myRecorder.stop();
+	else if (myRecorder.isRecording() && myRecorder.getNumFixtures() != kineticLights.size()) {
+		myRecorder.stop();
+		myRecordWarning = "Recording stopped, the number of fixtures changed";
+	}
+
+	if (!record || !myRecordPending)
+		return;
+	if (!*path) {
+		myRecordWarning = "Set a Record File to record to";
+		myRecordPending = false;
+	}
+	else if (myBakePlayback && myBakePath == path) {
+		myRecordWarning = "The Record File is playing";
+		myRecordPending = false;
+	}
+	else if (myBakeThread.joinable() && myBakingPath == path) {
+		myRecordWarning = "The Record File is being baked";
+		myRecordPending = false;
+	}
+	else {
+		size_t ringFrames = static_cast<size_t>(std::max(inputs->getParInt("Recordbuffer"), 2));
+		uint32_t keyframeInterval = static_cast<uint32_t>(std::max(inputs->getParInt("Bakekeyframe"), 1));
+		bool delta = inputs->getParInt("Bakedelta") != 0;
+		// The first frame is pushed by this cook. Timeline frame 1 is
+		// sample 0, as for a bake played by timeline frame.
+		const OP_TimeInfo* time = inputs->getTimeInfo();
+		double startIndex = floor(time->frame - 1.0 + 0.5);
+		if (myRecorder.start(path, kineticLights.size(), ringFrames, keyframeInterval, delta, startIndex, time->rate))
+			myRecordPending = false;
+	}
+}
+
+void
+CPlusPlusCHOPExample::updateSender(const OP_Inputs* inputs)
+{
+	const char* host = inputs->getParString("Sendhost");
+	if (!host)
+		host = "";
+	double rate = std::max(inputs->getParDouble("Sendrate"), 1.0);
+	DMXProtocol protocol = static_cast<DMXProtocol>(inputs->getParInt("Sendprotocol"));
+
+	bool send = inputs->getParInt("Send") != 0;
+	inputs->enablePar("Sendprotocol", send);
+	inputs->enablePar("Sendhost", send);
+	inputs->enablePar("Sendrate", send);
+	// sACN without a Destination goes to multicast
+	if (!send || (!*host && protocol != DMXProtocol::Sacn) || myNumUniverses == 0) {
+		mySender.stop();
+		return;
+	}
+
+	// A patch change restarts the sender, since it changes the size of every
+	// frame. A sender that failed to open waits for a settings change. The
+	// receiver reads the sender's log, so it's stopped while the log resets
+	// and restarted by updateReceiver().
+	bool changed = mySender.getProtocol() != protocol || mySender.getHost() != host || mySender.getRate() != rate ||
+				   mySender.getFirstUniverse() != myFirstUniverse || mySender.getNumUniverses() != myNumUniverses;
+	if (changed || (!mySender.isRunning() && !mySender.hasFailed())) {
+		myReceiver.stop();
+		mySender.start(protocol, host, rate, myFirstUniverse, myNumUniverses);
+	}
+}
+
+void
+CPlusPlusCHOPExample::updateFeedback(const OP_Inputs* inputs)
+{
+	uint16_t port = static_cast<uint16_t>(std::min(std::max(inputs->getParInt("Feedbackport"), 1), 65535));
+
+	bool feedback = inputs->getParInt("Feedback") != 0;
+	inputs->enablePar("Feedbackport", feedback);
+	inputs->enablePar("Feedbacktimeout", feedback);
+	inputs->enablePar("Feedbackkp", feedback);
+	inputs->enablePar("Feedbackki", feedback);
+	inputs->enablePar("Feedbackkd", feedback);
+	inputs->enablePar("Feedbackmax", feedback);
+	if (!feedback) {
+		myFeedback.stop();
+		return;
+	}
+
+	// execute() reads the table, which is sized for the fixtures
+	bool changed = myFeedback.getPort() != port || myFeedback.getNumFixtures() != kineticLights.size();
+	if (changed || (!myFeedback.isRunning() && !myFeedback.hasFailed()))
+		myFeedback.start(port, kineticLights.size());
+}
+
+void
+CPlusPlusCHOPExample::updateReceiver(const OP_Inputs* inputs)
+{
+	uint16_t port = static_cast<uint16_t>(std::min(std::max(inputs->getParInt("Receiveport"), 1), 65535));
+	const SendLog* log = mySender.isRunning() ? &mySender.getLog() : nullptr;
+
+	bool receive = inputs->getParInt("Receive") != 0;
+	inputs->enablePar("Receiveport", receive);
+	if (!receive) {
+		myReceiver.stop();
+		return;
+	}
+
+	bool changed = myReceiver.getPort() != port || myReceiver.getLog() != log ||
+				   myReceiver.getFirstUniverse() != myFirstUniverse || myReceiver.getNumUniverses() != myNumUniverses;
+	if (changed || (!myReceiver.isRunning() && !myReceiver.hasFailed()))
+		myReceiver.start(port, log, myFirstUniverse, myNumUniverses);
+}
+
+bool
+CPlusPlusCHOPExample::bakeShow(const OP_Inputs* inputs, const char* path)
+{
+	if (myPoseInputMode != PoseInputMode::Separate && myPoseInputMode != PoseInputMode::Packed) {
+		myBakeWarning = "Baking needs the pose on CHOP inputs";
+		return false;
+	}
+
+	// The show runs the length of the longest input. Frames are aligned on
+	// the inputs' newest samples, the same way a cook's timeslice is.
+	const OP_CHOPInput* longest = nullptr;
+	int32_t numPoseInputs = myPoseInputMode == PoseInputMode::Packed ? 1 : NUM_POSE_CHANNELS;
+	for (int32_t i = 0; i < 6; i++) {
+		const OP_CHOPInput* input = inputs->getInputCHOP(i);
+		if (i >= numPoseInputs && i < NUM_POSE_CHANNELS)
+			continue;
+		if (input && input->numChannels && (!longest || input->numSamples > longest->numSamples))
+			longest = input;
+	}
+	if (!longest || longest->numSamples <= 0 || kineticLights.empty()) {
+		myBakeWarning = "Nothing to bake, connect the show to the inputs";
+		return false;
+	}
+
+	// The file can't be rewritten while it's mapped or recorded to
+	if (myRecorder.isWriting() && myRecorder.getPath() == path) {
+		myBakeWarning = "The bake file is being recorded to";
+		return false;
+	}
+	closeBake();
+	myBakePath.clear();
+
+	const size_t numFixtures = kineticLights.size();
+	const size_t rowSize = numFixtures * NUM_POSE_CHANNELS;
+	const int32_t numFrames = longest->numSamples;
+	const OP_CHOPInput* speedInput = inputs->getInputCHOP(4);
+	const OP_CHOPInput* dmxInput = inputs->getInputCHOP(5);
+	auto sampleAt = [](const OP_CHOPInput* input, int32_t channel, int32_t back) {
+		return input->getChannelData(channel)[std::max(input->numSamples - 1 - back, 0)];
+	};
+
+	uint32_t keyframeInterval = static_cast<uint32_t>(std::max(inputs->getParInt("Bakekeyframe"), 1));
+	bool delta = inputs->getParInt("Bakedelta") != 0;
+	if (!myBakeWriter.open(path, numFixtures, keyframeInterval, delta, longest->startIndex, longest->sampleRate)) {
+		myBakeWriter.close();
+		myBakeWarning = "Couldn't write the bake file";
+		return false;
+	}
+
+	FrameInputs& in = myBakeInputs;
+	snapshotParameters(inputs, in);
+	in.planePose = false;
+	in.cuePose = false;
+	// No motor reports on a show that isn't playing
+	in.feedback.enabled = false;
+	in.poseSamples.assign(rowSize, 0.0f);
+	in.dmxValues.assign(std::max<size_t>(myDMXRoutes.size(), 62 - 4 + 1), 0.0f);
+	in.elapsed = longest->sampleRate > 0.0f ? 1.0f / longest->sampleRate : 0.0f;
+	in.numOutputSamples = 1;
+
+	// The CHOP inputs are only valid during the cook, so every frame's pose,
+	// speed and DMX values are copied for the bake thread now
+	myBakeFrames = numFrames;
+	myBakePoses.resize(static_cast<size_t>(numFrames) * rowSize);
+	myBakeSpeeds.resize(numFrames);
+	myBakeDMX.resize(static_cast<size_t>(numFrames) * in.dmxValues.size());
+	for (int32_t f = 0; f < numFrames; f++) {
+		int32_t back = numFrames - 1 - f;
+		snapshotCHOPPose(inputs, in, 1, back);
+		std::copy(in.poseSamples.begin(), in.poseSamples.end(), myBakePoses.begin() + f * rowSize);
+		myBakeSpeeds[f] = speedInput && speedInput->numChannels ? sampleAt(speedInput, 0, back) : 127.0f;
+		float* dmx = myBakeDMX.data() + f * in.dmxValues.size();
+		if (myDMXRoutesByName && dmxInput) {
+			for (size_t i = 0; i < myDMXRoutes.size(); i++)
+				dmx[i] = sampleAt(dmxInput, myDMXRoutes[i].inputIndex, back);
+		}
+		else {
+			for (int i = 4; i <= 62; i++)
+				dmx[i - 4] = dmxInput && (i - 1) < dmxInput->numChannels ? sampleAt(dmxInput, i - 1, back) : 0.0f;
+		}
+	}
+
+	// The baker is a node of its own with this one's layout, so its filters
+	// start from rest and the live ones carry on undisturbed
+	myBaker.reset(new CPlusPlusCHOPExample(myNodeInfo));
+	CPlusPlusCHOPExample& baker = *myBaker;
+	baker.kineticLights.reset(numFixtures);
+	baker.myPatch = myPatch;
+	baker.myFirstUniverse = myFirstUniverse;
+	baker.myNumUniverses = myNumUniverses;
+	baker.myUniverses.assign(myUniverses.size(), 0);
+	baker.myCollisionPairs = myCollisionPairs;
+	baker.myDMXRoutes = myDMXRoutes;
+	baker.myDMXRoutesByName = myDMXRoutesByName;
+	baker.resizeFrames();
+	baker.myFrameArena.reserve(frameArenaBytes(numFixtures));
+
+	myBakingPath = path;
+	myBakeFramesDone = 0;
+	myBakeCancel = false;
+	myBakeFinished = false;
+	myBakeWarning.clear();
+	myBakeThread = std::thread(&CPlusPlusCHOPExample::bakeLoop, this);
+	return true;
+}
+
+void
+CPlusPlusCHOPExample::bakeLoop()
+{
+	// Frames that can't be computed repeat the last one, like live cooks
+	CPlusPlusCHOPExample& baker = *myBaker;
+	FrameInputs& in = myBakeInputs;
+	const size_t rowSize = in.poseSamples.size();
+	const size_t numSlots = baker.kineticLights.size() * KineticLight::NUM_SLOTS;
+	std::vector<uint8_t> held(numSlots, 0);
+
+	// The filters see every frame of the show in order
+	bool written = true;
+	for (int32_t f = 0; f < myBakeFrames && written && !myBakeCancel; f++) {
+		in.frame = f;
+		std::copy(myBakePoses.begin() + f * rowSize, myBakePoses.begin() + (f + 1) * rowSize, in.poseSamples.begin());
+		in.speed = myBakeSpeeds[f];
+		const float* dmx = myBakeDMX.data() + f * in.dmxValues.size();
+		std::copy(dmx, dmx + in.dmxValues.size(), in.dmxValues.begin());
+
+		if (baker.computeFrame(in))
+			memcpy(held.data(), baker.kineticLights.getSlots(), numSlots);
+		written = myBakeWriter.write(held.data());
+		myBakeFramesDone = f + 1;
+	}
+	written = myBakeWriter.close() && written;
+	myBakeWritten = written && !myBakeCancel;
+	myBakeFinished = true;
+}
+
+void
+CPlusPlusCHOPExample::finishBake()
+{
+	if (!myBakeThread.joinable())
+		return;
+	myBakeThread.join();
+	myBaker.reset();
+	std::vector<float>().swap(myBakePoses);
+	std::vector<float>().swap(myBakeSpeeds);
+	std::vector<float>().swap(myBakeDMX);
+	myBakingPath.clear();
+	if (!myBakeWritten && !myBakeCancel)
+		myBakeWarning = "Couldn't write the bake file";
+}
+
+void
+CPlusPlusCHOPExample::cancelBake()
+{
+	myBakeCancel = true;
+	finishBake();
+}
+
+bool
+CPlusPlusCHOPExample::openBake(const char* path)
+{
+	myBakeWarning.clear();
+	if (!myBakeFile.open(path)) {
+		myBakeWarning = "Couldn't open the bake file";
+		return false;
+	}
+
+	// Check the whole file once, so playback can trust the index
+	const uint8_t* data = myBakeFile.data();
+	size_t size = myBakeFile.size();
+	const BakeHeader* header = reinterpret_cast<const BakeHeader*>(data);
+	bool valid = size >= sizeof(BakeHeader) &&
+		!memcmp(header->magic, BAKE_MAGIC, sizeof(header->magic)) &&
+		header->version == BAKE_VERSION &&
+		header->keyframeInterval > 0 && header->numFrames > 0 && header->sampleRate > 0.0 &&
+		header->indexOffset % alignof(BakeFrameEntry) == 0 &&
+		header->indexOffset <= size &&
+		(size - header->indexOffset) / sizeof(BakeFrameEntry) >= header->numFrames;
+	const BakeFrameEntry* index = valid ? reinterpret_cast<const BakeFrameEntry*>(data + header->indexOffset) : nullptr;
+	size_t numSlots = valid ? static_cast<size_t>(header->numFixtures) * KineticLight::NUM_SLOTS : 0;
+	for (uint32_t f = 0; valid && f < header->numFrames; f++) {
+		const BakeFrameEntry& entry = index[f];
+		valid = entry.offset <= size && entry.size <= size - entry.offset &&
+			(entry.delta ? f % header->keyframeInterval != 0 : entry.size == numSlots);
+	}
+	if (!valid) {
+		myBakeFile.close();
+		myBakeWarning = "The bake file is damaged or from another version";
+		return false;
+	}
+
+	myBakeHeader = header;
+	myBakeIndex = index;
+	myBakeDecodedFrame = -1;
+	return true;
+}
+
+void
+CPlusPlusCHOPExample::closeBake()
+{
+	myBakeFile.close();
+	myBakeHeader = nullptr;
+	myBakeIndex = nullptr;
+	myBakePath.clear();
+	myBakeDecodedFrame = -1;
+}
+
+bool
+CPlusPlusCHOPExample::playBake(const OP_TimeInfo* time)
+{
+	if (!myBakeHeader || myBakeHeader->numFixtures != kineticLights.size())
+		return false;
+
+	// Timeline frame 1 is sample index 0 of the baked inputs. Frames past
+	// either end of the show hold the first or last frame.
+	double sample = myPlayIndex;
+	if (!myPlayByIndex) {
+		double seconds = (time->frame - 1.0) / time->rate;
+		sample = floor(seconds * myBakeHeader->sampleRate + 0.5) - myBakeHeader->startIndex;
+	}
+	int64_t target = static_cast<int64_t>(clamp(sample, 0.0, static_cast<double>(myBakeHeader->numFrames - 1)));
+	if (target == myBakeDecodedFrame)
+		return true;
+
+	// Decode forward from the frame currently held when playing on, or from
+	// the keyframe before the target after a jump
+	int64_t first = target - target % myBakeHeader->keyframeInterval;
+	if (myBakeDecodedFrame >= first && myBakeDecodedFrame < target)
+		first = myBakeDecodedFrame + 1;
+	uint8_t* slots = kineticLights.getSlots();
+	size_t numSlots = kineticLights.size() * KineticLight::NUM_SLOTS;
+	for (int64_t f = first; f <= target; f++) {
+		if (!applyBakeFrame(myBakeFile.data(), myBakeIndex[f], slots, numSlots)) {
+			myBakeDecodedFrame = -1;
+			return false;
+		}
+	}
+	myBakeDecodedFrame = target;
+
+	packUniverses();
+	return true;
+}
+
+void
+CPlusPlusCHOPExample::updateDMXRoutes(const OP_CHOPInput* dmxInput)
+{
+	// The names are only compared once the input has cooked, since TD may
+	// keep their storage while renaming them, and only parsed when they've
+	// actually changed. The worker reads the routes, so it's paused first.
+	int32_t numChannels = dmxInput ? dmxInput->numChannels : 0;
+	uint32_t opId = dmxInput ? dmxInput->opId : 0;
+	int64_t cooks = dmxInput ? dmxInput->totalCooks : 0;
+	bool sameInput = !myDMXRoutesDirty && opId == myDMXRouteOpId;
+	if (sameInput && cooks == myDMXRouteCooks)
+		return;
+	myDMXRouteCooks = cooks;
+	if (sameInput && numChannels == (int32_t)myDMXRouteNames.size()) {
+		bool sameNames = true;
+		for (int32_t i = 0; i < numChannels && sameNames; i++)
+			sameNames = myDMXRouteNames[i] == dmxInput->getChannelName(i);
+		if (sameNames)
+			return;
+	}
+
+	pauseWorker();
+	myLayoutChanged = true;
+	myDMXRoutesDirty = false;
+	myDMXRouteOpId = opId;
+	myDMXRouteNames.clear();
+	for (int32_t i = 0; i < numChannels; i++)
+		myDMXRouteNames.push_back(dmxInput->getChannelName(i));
+	myDMXRoutes.clear();
+	myDMXUnrouted = 0;
+
+	// Keyed by (fixture, slot) so a slot named twice is fed by the last channel
+	std::unordered_map<int64_t, int32_t> slotToInput;
+	int32_t numNamed = 0;
+	for (int32_t i = 0; i < numChannels; i++) {
+		int32_t fixture, slot;
+		if (!parseDMXChannelName(dmxInput->getChannelName(i), fixture, slot))
+			continue;
+		numNamed++;
+		if (fixture >= (int32_t)kineticLights.size() || KineticLight::isMotionSlot(slot)) {
+			myDMXUnrouted++;
+			continue;
+		}
+		slotToInput[(int64_t(fixture) << 32) | slot] = i;
+	}
+	myDMXRoutesByName = numNamed > 0;
+
+	for (const auto& entry : slotToInput)
+		myDMXRoutes.push_back({ entry.second, int32_t(entry.first >> 32), int32_t(entry.first & 0xffffffff) });
+
+	// Write in slot order, and clear whatever the previous routing left behind
+	std::sort(myDMXRoutes.begin(), myDMXRoutes.end(), [](const DMXRoute& a, const DMXRoute& b) {
+		return a.fixture != b.fixture ? a.fixture < b.fixture : a.slot < b.slot;
+	});
+	for (size_t f = 0; f < kineticLights.size(); f++) {
+		for (int slot = 1; slot <= KineticLight::NUM_SLOTS; slot++) {
+			if (!KineticLight::isMotionSlot(slot))
+				kineticLights[f]->setSlot(slot, 0);
+		}
+	}
+}
+
+void
+CPlusPlusCHOPExample::updatePoseLayout(const OP_Inputs* inputs)
+{
+	// Pose channels mean something else in another mode, so the smoothing and
+	// prediction state restarts
+	PoseInputMode mode = static_cast<PoseInputMode>(inputs->getParInt("Poseinput"));
+	if (mode != myPoseInputMode) {
+		pauseWorker();
+		myLayoutChanged = true;
+		myPoseInputMode = mode;
+		myPoseWarning = nullptr;
+	}
+	inputs->enablePar("Packedlayout", myPoseInputMode == PoseInputMode::Packed);
+	inputs->enablePar("Posesop", myPoseInputMode == PoseInputMode::Sop);
+	inputs->enablePar("Orientattrib", myPoseInputMode == PoseInputMode::Sop);
+	for (const char* name : { "Posetop", "Heightscale", "Heightoffset", "Toptilt", "Mapsize" })
+		inputs->enablePar(name, myPoseInputMode == PoseInputMode::Top);
+	if (myPoseInputMode != PoseInputMode::Top)
+		myTOPDownload.release();
+
+	// The TOP's warning depends on its download, so only execute() sets and
+	// clears it. The SOP's is checked here for every cook, which keeps it
+	// up as long as the attribute is missing.
+	if (myPoseInputMode == PoseInputMode::Top)
+		return;
+	if (myPoseInputMode == PoseInputMode::Sop) {
+		myPoseWarning = nullptr;
+		const OP_SOPInput* sop = inputs->getParSOP("Posesop");
+		const char* orientName = inputs->getParString("Orientattrib");
+		if (sop && sop->getNumPoints() > 0 && orientName && orientName[0]) {
+			const SOP_CustomAttribData* attrib = sop->getCustomAttribute(orientName);
+			if (!attrib || attrib->attribType != AttribType::Float || attrib->numComponents < 3 || !attrib->floatData)
+				myPoseWarning = "Orientation attribute not found or not 3 floats, using point normals.";
+		}
+		return;
+	}
+	if (myPoseInputMode != PoseInputMode::Packed) {
+		myPoseWarning = nullptr;
+		return;
+	}
+
+	// Only pointer compares here, like updateDMXRoutes(). The layout is only
+	// read by execute(), so the worker can keep running.
+	const OP_CHOPInput* poseInput = inputs->getInputCHOP(0);
+	PackedLayout layout = static_cast<PackedLayout>(inputs->getParInt("Packedlayout"));
+	int32_t numChannels = poseInput ? poseInput->numChannels : 0;
+	uint32_t opId = poseInput ? poseInput->opId : 0;
+	if (layout == myPackedLayout && opId == myPoseLayoutOpId && numChannels == (int32_t)myPoseLayoutNames.size() &&
+		std::equal(myPoseLayoutNames.begin(), myPoseLayoutNames.end(), poseInput ? poseInput->nameData : nullptr))
+		return;
+
+	myPackedLayout = layout;
+	myPoseLayoutOpId = opId;
+	myPoseLayoutNames.assign(poseInput ? poseInput->nameData : nullptr, poseInput ? poseInput->nameData + numChannels : nullptr);
+	myPoseWarning = nullptr;
+
+	// Interleaved h r p y until the names say otherwise
+	myPackedFixtures = numChannels / NUM_POSE_CHANNELS;
+	myPoseChannelStride = NUM_POSE_CHANNELS;
+	for (int32_t c = 0; c < NUM_POSE_CHANNELS; c++)
+		myPoseChannelBase[c] = c;
+
+	if (numChannels == 0)
+		return;
+	if (numChannels % NUM_POSE_CHANNELS) {
+		myPoseWarning = "Packed pose input needs 4 channels per fixture.";
+		return;
+	}
+
+	// One block of NUM_POSE_CHANNELS kinds repeated per fixture, or one block
+	// of fixtures per kind. Either way each kind must start exactly one block.
+	int32_t n = myPackedFixtures;
+	bool interleaved = layout != PackedLayout::Grouped;
+	int32_t blockSize = interleaved ? 1 : n;
+	if (layout == PackedLayout::Auto) {
+		std::vector<int32_t> kinds(numChannels);
+		for (int32_t i = 0; i < numChannels; i++)
+			kinds[i] = parsePoseChannelName(poseInput->getChannelName(i));
+
+		auto matches = [&](int32_t size) {
+			int32_t seen = 0;
+			for (int32_t i = 0; i < numChannels; i++) {
+				int32_t first = ((i % (size * NUM_POSE_CHANNELS)) / size) * size;
+				if (kinds[i] < 0 || kinds[i] != kinds[first])
+					return false;
+				if (i == first)
+					seen |= 1 << kinds[i];
+			}
+			return seen == (1 << NUM_POSE_CHANNELS) - 1;
+		};
+		if (matches(1))
+			blockSize = 1;
+		else if (matches(n))
+			blockSize = n;
+		else {
+			myPoseWarning = "Packed pose channel names not recognized, reading them as h r p y per fixture.";
+			return;
+		}
+		interleaved = blockSize == 1;
+		for (int32_t b = 0; b < NUM_POSE_CHANNELS; b++)
+			myPoseChannelBase[kinds[b * blockSize]] = b * blockSize;
+	}
+	else {
+		for (int32_t c = 0; c < NUM_POSE_CHANNELS; c++)
+			myPoseChannelBase[c] = c * blockSize;
+	}
+	myPoseChannelStride = interleaved ? NUM_POSE_CHANNELS : 1;
+}
+
+void
+CPlusPlusCHOPExample::updateCues(const OP_Inputs* inputs)
+{
+	bool cues = myPoseInputMode == PoseInputMode::Cues;
+	for (const char* name : { "Cuedat", "Cuefile", "Cuereload", "Cue", "Cuefade", "Cuefademode", "Cuefine" })
+		inputs->enablePar(name, cues);
+	if (!cues)
+		return;
+
+	// The cue table comes from the Cue DAT, or the Cue File when no DAT is set.
+	// Only execute() reads the cues, so the worker can keep running.
+	const OP_DATInput* cueDAT = inputs->getParDAT("Cuedat");
+	const char* cueFile = inputs->getParFilePath("Cuefile");
+	if (!cueFile)
+		cueFile = "";
+	uint32_t cueDATId = cueDAT ? cueDAT->opId : 0;
+	int64_t cueDATCooks = cueDAT ? cueDAT->totalCooks : 0;
+	size_t numFixtures = kineticLights.size();
+
+	bool reload = myCueReload || cueDATId != myCueDATId || cueDATCooks != myCueDATCooks ||
+		myCueFile != cueFile || numFixtures != myCueFixtures;
+	if (reload) {
+		myCueReload = false;
+		myCueDATId = cueDATId;
+		myCueDATCooks = cueDATCooks;
+		myCueFile = cueFile;
+		myCueWarning = nullptr;
+
+		std::vector<std::vector<std::string>> table;
+		if (cueDAT && cueDAT->isTable) {
+			table.resize(cueDAT->numRows);
+			for (int32_t row = 0; row < cueDAT->numRows; row++) {
+				for (int32_t col = 0; col < cueDAT->numCols; col++)
+					table[row].push_back(cueDAT->getCell(row, col));
+			}
+		}
+		else if (*cueFile && !readTableFile(cueFile, table))
+			myCueWarning = "Couldn't read the Cue File";
+
+		if (numFixtures != myCueFixtures) {
+			myCueFixtures = numFixtures;
+			myCueFrom.assign(numFixtures * 3, 0);
+			myCueBlend.assign(numFixtures * 3, 0);
+			myCueFromValid.assign(numFixtures, 0);
+			myCueBlendValid.assign(numFixtures, 0);
+			myCueFromOrientation.assign(numFixtures * NUM_ORIENT_CHANNELS, 0.0f);
+			myCueBlendOrientation.assign(numFixtures * NUM_ORIENT_CHANNELS, 0.0f);
+			std::fill(myCueBlendOrientation.begin() + ORIENT_W * numFixtures, myCueBlendOrientation.begin() + (ORIENT_W + 1) * numFixtures, 1.0f);
+			myCueSlerpAngle.assign(numFixtures, 0.0f);
+		}
+		loadCues(table);
+
+		// Fade to the reloaded cue from wherever the output is
+		myCueFadeTarget = -1;
+	}
+
+	const char* name = inputs->getParString("Cue");
+	if (reload || myCueName != name) {
+		myCueName = name;
+		myCueTarget = -1;
+		for (size_t i = 0; i < myCues.size(); i++) {
+			if (myCues[i].name == myCueName)
+				myCueTarget = static_cast<int32_t>(i);
+		}
+		if (myCueTarget < 0 && !myCueName.empty() && !myCueWarning)
+			myCueWarning = "Cue not found in the cue table";
+		else if (myCueTarget >= 0 && myCueWarning && !strcmp(myCueWarning, "Cue not found in the cue table"))
+			myCueWarning = nullptr;
+	}
+}
+
+void
+CPlusPlusCHOPExample::loadCues(const std::vector<std::vector<std::string>>& table)
+{
+	myCues.clear();
+
+	// The columns are found by their 'cue', 'fixture', 'height', 'roll',
+	// 'pitch' and 'yaw' headers, otherwise they're taken in that order. A
+	// row without a fixture number sets every fixture of the cue.
+	int32_t cueCol = 0, fixtureCol = 1;
+	int32_t poseCols[NUM_POSE_CHANNELS] = { 2, 3, 4, 5 };
+	size_t firstRow = 0;
+	if (!table.empty()) {
+		static const char* const poseHeaders[NUM_POSE_CHANNELS] = { "height", "roll", "pitch", "yaw" };
+		bool named = false;
+		for (int32_t col = 0; col < (int32_t)table[0].size(); col++) {
+			const std::string& header = table[0][col];
+			named |= header == "cue" || header == "fixture";
+			for (int32_t c = 0; c < NUM_POSE_CHANNELS; c++)
+				named |= header == poseHeaders[c];
+		}
+		if (named) {
+			firstRow = 1;
+			cueCol = fixtureCol = -1;
+			std::fill(poseCols, poseCols + NUM_POSE_CHANNELS, -1);
+			for (int32_t col = 0; col < (int32_t)table[0].size(); col++) {
+				const std::string& header = table[0][col];
+				if (header == "cue")
+					cueCol = col;
+				else if (header == "fixture")
+					fixtureCol = col;
+				for (int32_t c = 0; c < NUM_POSE_CHANNELS; c++) {
+					if (header == poseHeaders[c])
+						poseCols[c] = col;
+				}
+			}
+		}
+	}
+
+	size_t numFixtures = myCueFixtures;
+	for (size_t row = firstRow; row < table.size(); row++) {
+		const std::vector<std::string>& cells = table[row];
+		auto cell = [&](int32_t col) { return col >= 0 && col < (int32_t)cells.size() ? cells[col].c_str() : ""; };
+		const char* name = cell(cueCol);
+		if (!*name)
+			continue;
+
+		auto cue = std::find_if(myCues.begin(), myCues.end(), [&](const Cue& c) { return c.name == name; });
+		if (cue == myCues.end()) {
+			myCues.emplace_back();
+			cue = myCues.end() - 1;
+			cue->name = name;
+			cue->pose.assign(numFixtures * NUM_POSE_CHANNELS, 0.0f);
+			for (size_t f = 0; f < numFixtures; f++)
+				cue->pose[f * NUM_POSE_CHANNELS + POSE_HEIGHT] = NAN;
+			cue->motors.assign(numFixtures * 3, 0);
+			cue->valid.assign(numFixtures, 0);
+			cue->orientation.assign(numFixtures * NUM_ORIENT_CHANNELS, 0.0f);
+			cue->computed = false;
+		}
+
+		size_t first = 0, last = numFixtures;
+		if (*cell(fixtureCol)) {
+			int32_t fixture = atoi(cell(fixtureCol)) - 1;
+			if (fixture < 0 || fixture >= (int32_t)numFixtures)
+				continue;
+			first = fixture;
+			last = fixture + 1;
+		}
+		for (int32_t c = 0; c < NUM_POSE_CHANNELS; c++) {
+			if (!*cell(poseCols[c]))
+				continue;
+			float value = static_cast<float>(atof(cell(poseCols[c])));
+			for (size_t f = first; f < last; f++)
+				cue->pose[f * NUM_POSE_CHANNELS + c] = value;
+		}
+	}
+}
+
+void
+CPlusPlusCHOPExample::updatePatch(const OP_Inputs* inputs)
+{
+	int32_t numFixtures = std::max(1, inputs->getParInt("Fixtures"));
+	int32_t startUniverse = inputs->getParInt("Startuniverse");
+	if (static_cast<DMXProtocol>(inputs->getParInt("Sendprotocol")) == DMXProtocol::Sacn)
+		startUniverse = clamp(startUniverse, SACN_MIN_UNIVERSE, SACN_MAX_UNIVERSE);
+	int32_t startAddress = inputs->getParInt("Startaddress");
+	const OP_DATInput* patchDAT = inputs->getParDAT("Patchdat");
+	uint32_t patchDATId = patchDAT ? patchDAT->opId : 0;
+	int64_t patchDATCooks = patchDAT ? patchDAT->totalCooks : 0;
+
+	if (numFixtures == myPatchFixtures && startUniverse == myPatchStartUniverse && startAddress == myPatchStartAddress &&
+		patchDATId == myPatchDATId && patchDATCooks == myPatchDATCooks)
+		return;
+	myPatchFixtures = numFixtures;
+	myPatchStartUniverse = startUniverse;
+	myPatchStartAddress = startAddress;
+	myPatchDATId = patchDATId;
+	myPatchDATCooks = patchDATCooks;
+
+	// A Patch DAT can cook every frame without changing. Rebuilding restarts
+	// every fixture's smoothing and limits, so only a different patch does.
+	std::string warning;
+	buildPatch(patchDAT, startUniverse, startAddress, static_cast<size_t>(numFixtures), myNextPatch, warning);
+	if (myNextPatch.size() == myPatch.size() && warning == myPatchWarning &&
+		memcmp(myNextPatch.data(), myPatch.data(), myPatch.size() * sizeof(FixturePatch)) == 0)
+		return;
+
+	// Rebuild all fixtures and their motors in one go
+	pauseWorker();
+	myLayoutChanged = true;
+	kineticLights.reset(numFixtures);
+	myDMXRoutesDirty = true;
+	myPatch.swap(myNextPatch);
+	myPatchWarning = warning;
+	loadPatch(startUniverse);
+}
+
+void
+CPlusPlusCHOPExample::buildPatch(const OP_DATInput* patchDAT, int32_t startUniverse, int32_t startAddress, size_t numFixtures,
+								 std::vector<FixturePatch>& patches, std::string& warning) const
+{
+	// Patch fixtures back to back from the start address, moving on to the
+	// next universe when a fixture doesn't fit in the current one. Every
+	// field is set, so patches compare bytewise.
+	int32_t universe = startUniverse;
+	int32_t address = clamp(startAddress, 1, DMX_UNIVERSE_SIZE - KineticLight::NUM_SLOTS + 1);
+	patches.resize(numFixtures);
+
+	// Height map UVs default to a square grid, filled row by row from the bottom left
+	int32_t gridSize = static_cast<int32_t>(ceil(sqrt(static_cast<double>(patches.size()))));
+	int32_t gridRows = gridSize ? static_cast<int32_t>((patches.size() + gridSize - 1) / gridSize) : 0;
+	for (size_t f = 0; f < patches.size(); f++) {
+		FixturePatch& patch = patches[f];
+		if (address + KineticLight::NUM_SLOTS - 1 > DMX_UNIVERSE_SIZE) {
+			universe++;
+			address = 1;
+		}
+		patch.universe = universe;
+		patch.address = address;
+		address += KineticLight::NUM_SLOTS;
+		patch.u = (f % gridSize + 0.5f) / gridSize;
+		patch.v = (f / gridSize + 0.5f) / gridRows;
+		patch.x = NAN;
+		patch.z = NAN;
+	}
+
+	// Rows of the Patch DAT override individual fixtures. The columns are
+	// found by their 'fixture', 'universe' and 'address' headers, otherwise
+	// they're taken in that order. Optional 'u' and 'v' columns place the
+	// fixture on the height map, 'x' and 'z' in the rig.
+	if (patchDAT && patchDAT->isTable && patchDAT->numCols >= 3) {
+		int32_t fixtureCol = 0, universeCol = 1, addressCol = 2;
+		int32_t uCol = -1, vCol = -1, xCol = -1, zCol = -1;
+		int32_t firstRow = 0;
+		for (int32_t col = 0; col < patchDAT->numCols; col++) {
+			const char* header = patchDAT->getCell(0, col);
+			if (!strcmp(header, "fixture")) { fixtureCol = col; firstRow = 1; }
+			else if (!strcmp(header, "universe")) { universeCol = col; firstRow = 1; }
+			else if (!strcmp(header, "address")) { addressCol = col; firstRow = 1; }
+			else if (!strcmp(header, "u")) { uCol = col; firstRow = 1; }
+			else if (!strcmp(header, "v")) { vCol = col; firstRow = 1; }
+			else if (!strcmp(header, "x")) { xCol = col; firstRow = 1; }
+			else if (!strcmp(header, "z")) { zCol = col; firstRow = 1; }
+		}
+
+		for (int32_t row = firstRow; row < patchDAT->numRows; row++) {
+			int32_t fixture = atoi(patchDAT->getCell(row, fixtureCol)) - 1;
+			if (fixture < 0 || fixture >= (int32_t)patches.size())
+				continue;
+			if (uCol >= 0)
+				patches[fixture].u = static_cast<float>(atof(patchDAT->getCell(row, uCol)));
+			if (vCol >= 0)
+				patches[fixture].v = static_cast<float>(atof(patchDAT->getCell(row, vCol)));
+			if (xCol >= 0)
+				patches[fixture].x = static_cast<float>(atof(patchDAT->getCell(row, xCol)));
+			if (zCol >= 0)
+				patches[fixture].z = static_cast<float>(atof(patchDAT->getCell(row, zCol)));
+
+			int32_t rowAddress = atoi(patchDAT->getCell(row, addressCol));
+			if (rowAddress < 1 || rowAddress + KineticLight::NUM_SLOTS - 1 > DMX_UNIVERSE_SIZE) {
+				warning = "Patch DAT row " + std::to_string(row) + ": address doesn't fit an 80 slot fixture.";
+				continue;
+			}
+			patches[fixture].universe = atoi(patchDAT->getCell(row, universeCol));
+			patches[fixture].address = rowAddress;
+		}
+	}
+}
+
+void
+CPlusPlusCHOPExample::loadPatch(int32_t startUniverse)
+{
+	myWarning = myPatchWarning;
+
+	int32_t firstUniverse = myPatch.empty() ? startUniverse : myPatch[0].universe;
+	int32_t lastUniverse = firstUniverse;
+	for (const FixturePatch& patch : myPatch) {
+		firstUniverse = std::min(firstUniverse, patch.universe);
+		lastUniverse = std::max(lastUniverse, patch.universe);
+	}
+
+	const int32_t maxUniverses = 256;
+	if (lastUniverse - firstUniverse + 1 > maxUniverses) {
+		myWarning = "Patch spans more than 256 universes, the rest are not output.";
+		lastUniverse = firstUniverse + maxUniverses - 1;
+	}
+
+	myCollisionPairsDirty = true;
+
+	myFirstUniverse = firstUniverse;
+	myNumUniverses = lastUniverse - firstUniverse + 1;
+	myUniverses.assign(static_cast<size_t>(myNumUniverses) * DMX_UNIVERSE_SIZE, 0);
+	myChannelNamesDirty = true;
+
+	// Look for fixtures sharing slots, using the universe buffer as scratch
+	for (const FixturePatch& patch : myPatch) {
+		if (patch.universe > lastUniverse)
+			continue;
+		uint8_t* slots = &myUniverses[(patch.universe - firstUniverse) * DMX_UNIVERSE_SIZE + patch.address - 1];
+		for (int i = 0; i < KineticLight::NUM_SLOTS; i++) {
+			if (slots[i]++ && myWarning.empty())
+				myWarning = "Fixtures overlap at universe " + std::to_string(patch.universe) + " address " + std::to_string(patch.address + i) + ".";
+		}
+	}
+	std::fill(myUniverses.begin(), myUniverses.end(), uint8_t(0));
+}
+
+void
+CPlusPlusCHOPExample::updateCollisionPairs(const OP_Inputs* inputs)
+{
+	bool enabled = inputs->getParInt("Avoidcollisions") != 0;
+	for (const char* name : { "Fixtureradius", "Clearance", "Collisioniterations", "Gridspacing" })
+		inputs->enablePar(name, enabled);
+	if (!enabled)
+		return;
+
+	float radius = static_cast<float>(inputs->getParDouble("Fixtureradius"));
+	float spacing = static_cast<float>(inputs->getParDouble("Gridspacing"));
+	if (!myCollisionPairsDirty && radius == myCollisionRadius && spacing == myCollisionSpacing)
+		return;
+
+	pauseWorker();
+	myCollisionPairsDirty = false;
+	myCollisionRadius = radius;
+	myCollisionSpacing = spacing;
+	myCollisionPairs.clear();
+
+	// Fixtures without a position in the Patch DAT sit on the same square
+	// grid as the height map UVs, Grid Spacing apart
+	size_t numFixtures = myPatch.size();
+	int32_t gridSize = static_cast<int32_t>(ceil(sqrt(static_cast<double>(numFixtures))));
+	std::vector<float> x(numFixtures), z(numFixtures);
+	for (size_t f = 0; f < numFixtures; f++) {
+		x[f] = std::isnan(myPatch[f].x) ? (f % gridSize) * spacing : myPatch[f].x;
+		z[f] = std::isnan(myPatch[f].z) ? (f / gridSize) * spacing : myPatch[f].z;
+	}
+
+	// Plates overlap seen from above when their centers are closer than two
+	// radii, so hashing the centers into cells that size only leaves the
+	// neighbouring cells to search
+	float reach = 2.0f * radius;
+	if (!(reach > 0.0f))
+		return;
+	auto cellKey = [](int64_t cx, int64_t cz) { return static_cast<int64_t>((static_cast<uint64_t>(cx) << 32) ^ static_cast<uint32_t>(cz)); };
+	std::unordered_map<int64_t, std::vector<uint32_t>> cells;
+	for (size_t f = 0; f < numFixtures; f++)
+		cells[cellKey(static_cast<int64_t>(floor(x[f] / reach)), static_cast<int64_t>(floor(z[f] / reach)))].push_back(static_cast<uint32_t>(f));
+
+	for (size_t f = 0; f < numFixtures; f++) {
+		int64_t cx = static_cast<int64_t>(floor(x[f] / reach));
+		int64_t cz = static_cast<int64_t>(floor(z[f] / reach));
+		for (int64_t ox = -1; ox <= 1; ox++) {
+			for (int64_t oz = -1; oz <= 1; oz++) {
+				auto cell = cells.find(cellKey(cx + ox, cz + oz));
+				if (cell == cells.end())
+					continue;
+				for (uint32_t other : cell->second) {
+					if (other <= f)
+						continue;
+					float dx = x[other] - x[f];
+					float dz = z[other] - z[f];
+					float distance = sqrtf(dx * dx + dz * dz);
+					if (distance >= reach)
+						continue;
+					// Fixtures hung at the same point are pushed apart along X
+					CollisionPair pair = { static_cast<uint32_t>(f), other, 1.0f, 0.0f, distance };
+					if (distance > 0.0f) {
+						pair.dx = dx / distance;
+						pair.dz = dz / distance;
+					}
+					myCollisionPairs.push_back(pair);
+				}
+			}
+		}
+	}
+}
+
+void
+CPlusPlusCHOPExample::avoidCollisions(const FrameInputs& in, float* heights, const float* motorHeights)
+{
+	// Each fixture's plate, relative to its center, rises gx along X and gz
+	// along Z. The slopes come straight from the motor heights, measured at
+	// the motor positions calculatePlaneMotorHeights() uses.
+	const float s = static_cast<float>(in.mapping.baseSize);
+	const float r = s * static_cast<float>(sqrt(3.0) / 6.0);
+	if (!(s > 0.0f))
+		return;
+	auto plate = [&](uint32_t f, float dx, float dz, float& center, float& slope, float& crossSlope) {
+		const float* h = motorHeights + f * 3;
+		center = (h[0] + h[1] + h[2]) / 3.0f;
+		float gx = (h[1] - h[0]) / s;
+		float gz = (center - h[2]) / (2.0f * r);
+		slope = gx * dx + gz * dz;
+		crossSlope = gz * dx - gx * dz;
+	};
+
+	// Seen from above, the plates of two fixtures D apart overlap in a lens.
+	// Along the line between the centers it runs from D - R to R out of the
+	// first one, and its tips sit halfway, sqrt(R^2 - (D/2)^2) to either side
+	// of the line. The gap between the plates is linear, so it's checked at
+	// those four points. Whichever plate is above stays above, and both move
+	// by half of what's missing, the smallest change that restores the
+	// clearance, without being pushed past Min or Max Height. A few passes
+	// settle fixtures with several neighbours.
+	const float radius = in.fixtureRadius;
+	const float clearance = in.clearance;
+	const float minHeight = static_cast<float>(in.mapping.minHeight);
+	const float maxHeight = static_cast<float>(in.mapping.maxHeight);
+	auto push = [&](float& height, float offset) {
+		height = clamp(height + offset, std::min(height, minHeight), std::max(height, maxHeight));
+	};
+	for (int32_t pass = 0; pass < in.collisionIterations; pass++) {
+		for (const CollisionPair& pair : myCollisionPairs) {
+			float centerA, slopeA, crossA, centerB, slopeB, crossB;
+			plate(pair.a, pair.dx, pair.dz, centerA, slopeA, crossA);
+			plate(pair.b, pair.dx, pair.dz, centerB, slopeB, crossB);
+
+			// Gap at 'along' out of a towards b and 'across' to its left
+			auto gap = [&](float along, float across) {
+				return (heights[pair.a] + centerA + slopeA * along + crossA * across) -
+					   (heights[pair.b] + centerB + slopeB * (along - pair.distance) + crossB * across);
+			};
+			float half = pair.distance * 0.5f;
+			float tip = sqrtf(std::max(radius * radius - half * half, 0.0f));
+			float gaps[4] = { gap(pair.distance - radius, 0.0f), gap(radius, 0.0f), gap(half, tip), gap(half, -tip) };
+			float side = gaps[0] + gaps[1] + gaps[2] + gaps[3] >= 0.0f ? 1.0f : -1.0f;
+			float closest = std::min(std::min(side * gaps[0], side * gaps[1]), std::min(side * gaps[2], side * gaps[3]));
+			float missing = clearance - closest;
+			if (missing > 0.0f) {
+				push(heights[pair.a], side * missing * 0.5f);
+				push(heights[pair.b], -side * missing * 0.5f);
+			}
+		}
+	}
+}
+
+void
+CPlusPlusCHOPExample::updateChannelNames()
+{
+	if (!myChannelNamesDirty && myChannelNamesMode == myOutputMode && myChannelNamesLayout == myUniverseLayout)
+		return;
+
+	myChannelNamesDirty = false;
+	myChannelNamesMode = myOutputMode;
+	myChannelNamesLayout = myUniverseLayout;
+	myChannelNames.clear();
+	myChannelNameOffsets.clear();
+
+	char channelName[32];
+	auto addName = [&](int length) {
+		myChannelNameOffsets.push_back(static_cast<uint32_t>(myChannelNames.size()));
+		myChannelNames.insert(myChannelNames.end(), channelName, channelName + length + 1);
+	};
+
+	if (myOutputMode == OutputMode::Universes && myUniverseLayout == UniverseLayout::UniverseChannels) {
+		for (int32_t u = 0; u < myNumUniverses; u++)
+			addName(snprintf(channelName, sizeof(channelName), "u%d", myFirstUniverse + u));
+	}
+	else if (myOutputMode == OutputMode::Universes) {
+		myChannelNames.reserve(static_cast<size_t>(myNumUniverses) * DMX_UNIVERSE_SIZE * 10);
+		for (int32_t u = 0; u < myNumUniverses; u++) {
+			for (int s = 1; s <= DMX_UNIVERSE_SIZE; s++)
+				addName(snprintf(channelName, sizeof(channelName), "u%d_s%d", myFirstUniverse + u, s));
+		}
+	}
+	else {
+		// fx<fixture>_m<motor>_<function>, with the lighting channels of a
+		// motor named after their channel number
+		static const char* motionNames[] = { "height", "fine", "speed" };
+		myChannelNames.reserve(kineticLights.size() * KineticLight::NUM_SLOTS * 16);
+		for (size_t f = 0; f < kineticLights.size(); f++) {
+			for (int slot = 1; slot <= KineticLight::NUM_SLOTS; slot++) {
+				int motor = slot <= 62 ? 1 : slot <= 71 ? 2 : 3;
+				int channel = slot - (motor == 1 ? 0 : motor == 2 ? 62 : 71);
+				if (channel <= 3)
+					addName(snprintf(channelName, sizeof(channelName), "fx%d_m%d_%s", (int)f + 1, motor, motionNames[channel - 1]));
+				else
+					addName(snprintf(channelName, sizeof(channelName), "fx%d_m%d_ch%d", (int)f + 1, motor, channel));
+			}
+		}
+	}
+}
+
+void
+CPlusPlusCHOPExample::packUniverses()
+{
+	for (size_t f = 0; f < kineticLights.size() && f < myPatch.size(); f++) {
+		const FixturePatch& patch = myPatch[f];
+		int32_t universe = patch.universe - myFirstUniverse;
+		if (universe < 0 || universe >= myNumUniverses)
+			continue;
+		memcpy(&myUniverses[universe * DMX_UNIVERSE_SIZE + patch.address - 1], kineticLights[f]->getSlots(), KineticLight::NUM_SLOTS);
+	}
+}
+
+int32_t
+CPlusPlusCHOPExample::getNumInfoCHOPChans(void * reserved1)
+{
+	// We return the number of channel we want to output to any Info CHOP
+	// connected to the CHOP. In this example we are just going to send one channel.
+	return 22;
+}
+
+void
+CPlusPlusCHOPExample::getInfoCHOPChan(int32_t index,
+										OP_InfoCHOPChan* chan,
+										void* reserved1)
+{
+	// This function will be called once for each channel we said we'd want to return
+	// In this example it'll only be called once.
+
+	if (index == 0)
+	{
+		chan->name->setString("executeCount");
+		chan->value = (float)myExecuteCount;
+	}
+
+	if (index == 1)
+	{
+		chan->name->setString("offset");
+		chan->value = (float)myOffset;
+	}
+
+	if (index == 2)
+	{
+		chan->name->setString("dmxRoutes");
+		chan->value = (float)myDMXRoutes.size();
+	}
+
+	if (index == 3)
+	{
+		chan->name->setString("dmxUnrouted");
+		chan->value = (float)myDMXUnrouted;
+	}
+
+	if (index == 4)
+	{
+		chan->name->setString("cookAllocations");
+		chan->value = (float)myCookAllocations;
+	}
+
+	if (index == 5)
+	{
+		chan->name->setString("bakeFrame");
+		chan->value = myBakePlayback ? (float)myBakeDecodedFrame : -1.0f;
+	}
+
+	if (index == 6)
+	{
+		chan->name->setString("recordFrames");
+		chan->value = (float)myRecorder.getFramesWritten();
+	}
+
+	if (index == 7)
+	{
+		chan->name->setString("recordDropped");
+		chan->value = (float)myRecorder.getFramesDropped();
+	}
+
+	if (index == 8)
+	{
+		chan->name->setString("limitedFixtures");
+		chan->value = (float)(myOutputLimitHits.size() - std::count(myOutputLimitHits.begin(), myOutputLimitHits.end(), uint8_t(0)));
+	}
+
+	if (index == 9)
+	{
+		chan->name->setString("sendJitter");
+		chan->value = mySender.getJitter();
+	}
+
+	if (index == 10)
+	{
+		chan->name->setString("sendJitterMax");
+		chan->value = mySender.getMaxJitter();
+	}
+
+	if (index == 11)
+	{
+		chan->name->setString("sendFrames");
+		chan->value = (float)mySender.getFramesSent();
+	}
+
+	if (index == 12)
+	{
+		chan->name->setString("sendTime");
+		chan->value = mySender.getSendTime();
+	}
+
+	if (index == 13)
+	{
+		chan->name->setString("receivePackets");
+		chan->value = (float)myReceiver.getPacketsReceived();
+	}
+
+	if (index == 14)
+	{
+		chan->name->setString("receiveLost");
+		chan->value = (float)myReceiver.getPacketsLost();
+	}
+
+	if (index == 15)
+	{
+		chan->name->setString("receiveMismatches");
+		chan->value = (float)myReceiver.getMismatches();
+	}
+
+	if (index == 16)
+	{
+		chan->name->setString("receiveLatency");
+		chan->value = myReceiver.getLatency();
+	}
+
+	if (index == 17)
+	{
+		chan->name->setString("receiveLatencyMax");
+		chan->value = myReceiver.getMaxLatency();
+	}
+
+	if (index == 18)
+	{
+		chan->name->setString("feedbackMotors");
+		chan->value = (float)myFeedbackMotors;
+	}
+
+	if (index == 19)
+	{
+		chan->name->setString("feedbackError");
+		chan->value = myOutputFeedbackError;
+	}
+
+	if (index == 20)
+	{
+		chan->name->setString("heldFrames");
+		chan->value = (float)myHeldFrames;
+	}
+
+	if (index == 21)
+	{
+		chan->name->setString("bakeProgress");
+		chan->value = myBakeFrames ? (float)myBakeFramesDone / myBakeFrames : 0.0f;
+	}
+}
+
+bool		
+CPlusPlusCHOPExample::getInfoDATSize(OP_InfoDATSize* infoSize, void* reserved1)
+{
+	// executeCount, offset, bakeFrames, then each fixture's safety limit hits
+	infoSize->rows = 3 + static_cast<int32_t>(myOutputLimitHits.size());
+	infoSize->cols = 2;
+	// Setting this to false means we'll be assigning values to the table
+	// one row at a time. True means we'll do it one column at a time.
+	infoSize->byColumn = false;
+	return true;
+}
+
+void
+CPlusPlusCHOPExample::getInfoDATEntries(int32_t index,
+										int32_t nEntries,
+										OP_InfoDATEntries* entries, 
+										void* reserved1)
+{
+	char tempBuffer[4096];
+
+	if (index == 0)
+	{
+		// Set the value for the first column
+		entries->values[0]->setString("executeCount");
+
+		// Set the value for the second column
+#ifdef _WIN32
+		sprintf_s(tempBuffer, "%d", myExecuteCount);
+#else // macOS
+		snprintf(tempBuffer, sizeof(tempBuffer), "%d", myExecuteCount);
+#endif
+		entries->values[1]->setString(tempBuffer);
+	}
+
+	if (index == 1)
+	{
+		// Set the value for the first column
+		entries->values[0]->setString("offset");
+
+		// Set the value for the second column
+#ifdef _WIN32
+		sprintf_s(tempBuffer, "%g", myOffset);
+#else // macOS
+		snprintf(tempBuffer, sizeof(tempBuffer), "%g", myOffset);
+#endif
+		entries->values[1]->setString( tempBuffer);
+	}
+
+	if (index == 2)
+	{
+		// Frames of the last bake written so far, out of the show's length
+		entries->values[0]->setString("bakeFrames");
+
+#ifdef _WIN32
+		sprintf_s(tempBuffer, "%d/%d", (int)myBakeFramesDone, myBakeFrames);
+#else // macOS
+		snprintf(tempBuffer, sizeof(tempBuffer), "%d/%d", (int)myBakeFramesDone, myBakeFrames);
+#endif
+		entries->values[1]->setString(tempBuffer);
+	}
+
+	if (index >= 3 && index - 3 < (int32_t)myOutputLimitHits.size())
+	{
+		// SafetyLimitBits: 1 height, 2 spread, 4 speed
+#ifdef _WIN32
+		sprintf_s(tempBuffer, "fx%d_limits", index - 2);
+#else // macOS
+		snprintf(tempBuffer, sizeof(tempBuffer), "fx%d_limits", index - 2);
+#endif
+		entries->values[0]->setString(tempBuffer);
+
+#ifdef _WIN32
+		sprintf_s(tempBuffer, "%d", myOutputLimitHits[index - 3]);
+#else // macOS
+		snprintf(tempBuffer, sizeof(tempBuffer), "%d", myOutputLimitHits[index - 3]);
+#endif
+		entries->values[1]->setString(tempBuffer);
+	}
+}
+
+void
+CPlusPlusCHOPExample::getWarningString(OP_String* warning, void* reserved1)
+{
+	if (!myWarning.empty())
+		warning->setString(myWarning.c_str());
+	else if (myOutputArenaExhausted)
+		warning->setString("Frame arena exhausted, holding the last valid frame");
+	else if (!myBakeWarning.empty())
+		warning->setString(myBakeWarning.c_str());
+	else if (myBakePlayback && myBakeHeader && myBakeHeader->numFixtures != kineticLights.size())
+		warning->setString("The bake file was baked for a different number of fixtures");
+	else if (myRecorder.hasFailed())
+		warning->setString("Couldn't write the record file");
+	else if (myRecordWarning)
+		warning->setString(myRecordWarning);
+	else if (mySender.hasFailed())
+		warning->setString("Couldn't send DMX to the Destination");
+	else if (mySender.isRunning() && mySender.getProtocol() == DMXProtocol::Enttec && myNumUniverses > 1)
+		warning->setString("ENTTEC DMX USB Pro only sends the first universe");
+	else if (myReceiver.hasFailed())
+		warning->setString("Couldn't listen on the Receive Port");
+	else if (myFeedback.hasFailed())
+		warning->setString("Couldn't listen on the Feedback Port");
+	else if (myCueWarning && myPoseInputMode == PoseInputMode::Cues)
+		warning->setString(myCueWarning);
+	else if (myPoseWarning)
+		warning->setString(myPoseWarning);
+}
+
+void
+CPlusPlusCHOPExample::buildDynamicMenu(const OP_Inputs* inputs, OP_BuildDynamicMenuInfo* info, void* reserved1)
+{
+
+}
+
+void
+CPlusPlusCHOPExample::setupParameters(OP_ParameterManager* manager, void *reserved1)
+{
+	
+
+
+	
+
+
+
+	{
+		OP_NumericParameter np;
+		np.name = "Basesize";
+		np.label = "Base Size";
+		np.defaultValues[0] = 1.0;
+		np.minSliders[0] = 0.1;
+		np.maxSliders[0] = 5.0;
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+		np.name = "Minheight";
+		np.label = "Min Height";
+		np.defaultValues[0] = 0.5;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 1.0;
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+		np.name = "Maxheight";
+		np.label = "Max Height";
+		np.defaultValues[0] = 3.0;
+		np.minSliders[0] = 1.0;
+		np.maxSliders[0] = 10.0;
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+
+	// pitch
+	{
+		OP_NumericParameter np;
+
+		np.name = "Minpitch";
+		np.label = "Min Pitch";
+		np.defaultValues[0] = -45.0;
+		np.minSliders[0] = -90.0;
+		np.maxSliders[0] = 90.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Maxpitch";
+		np.label = "Max Pitch";
+		np.defaultValues[0] = 45.0;
+		np.minSliders[0] = -90.0;
+		np.maxSliders[0] = 90.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// roll
+	{
+		OP_NumericParameter np;
+
+		np.name = "Minroll";
+		np.label = "Min Roll";
+		np.defaultValues[0] = -45.0;
+		np.minSliders[0] = -90.0;
+		np.maxSliders[0] = 90.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Maxroll";
+		np.label = "Max Roll";
+		np.defaultValues[0] = 45.0;
+		np.minSliders[0] = -90.0;
+		np.maxSliders[0] = 90.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// yaw
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Minyaw";
+		np.label = "Min Yaw";
+		np.defaultValues[0] = -45.0;
+		np.minSliders[0] = -90.0;
+		np.maxSliders[0] = 90.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Maxyaw";
+		np.label = "Max Yaw";
+		np.defaultValues[0] = 45.0;
+		np.minSliders[0] = -90.0;
+		np.maxSliders[0] = 90.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// need parameters for calibation of  max Hieght that motor can goes, min Height and 0 to 255 min DMXOUT and ,ax DMXOUT
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Calibrationmaxheight";
+		np.label = "Motor Calibration Max height";
+		np.defaultValues[0] = 3.0;
+		np.minSliders[0] = 1.0;
+		np.maxSliders[0] = 10.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Calibrationminheight";
+		np.label = "Motor Calibration Min height";
+		np.defaultValues[0] = 0.5;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 1.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Calibrationmindmxout";
+		np.label = "Motor Calibration Min DMXOUT";
+		np.defaultValues[0] = 0.0;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 255.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Calibrationmaxdmxout";
+		np.label = "Motor Calibration Max DMXOUT";
+		np.defaultValues[0] = 255.0;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 255.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+
+	}
+
+	// Fixture patch and output format
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Fixtures";
+		np.label = "Fixtures";
+		np.page = "Output";
+		np.defaultValues[0] = 1;
+		np.minValues[0] = 1;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 64;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Patchdat";
+		sp.label = "Patch DAT";
+		sp.page = "Output";
+
+		OP_ParAppendResult res = manager->appendDAT(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Startuniverse";
+		np.label = "Start Universe";
+		np.page = "Output";
+		np.defaultValues[0] = 1;
+		np.minValues[0] = 0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 64;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Startaddress";
+		np.label = "Start Address";
+		np.page = "Output";
+		np.defaultValues[0] = 1;
+		np.minValues[0] = 1;
+		np.maxValues[0] = DMX_UNIVERSE_SIZE - KineticLight::NUM_SLOTS + 1;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = DMX_UNIVERSE_SIZE - KineticLight::NUM_SLOTS + 1;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Outputmode";
+		sp.label = "Output Mode";
+		sp.page = "Output";
+		sp.defaultValue = "Channels";
+
+		const char* names[] = { "Channels", "Universes" };
+		const char* labels[] = { "Fixture Channels", "DMX Universes" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Universelayout";
+		sp.label = "Universe Layout";
+		sp.page = "Output";
+		sp.defaultValue = "Slotchannels";
+
+		const char* names[] = { "Slotchannels", "Universechannels" };
+		const char* labels[] = { "Channel per Slot", "Channel per Universe" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Output resampling
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Resample";
+		np.label = "Resample Output";
+		np.page = "Output";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Outputrate";
+		np.label = "Output Rate";
+		np.page = "Output";
+		np.defaultValues[0] = 44.0;
+		np.minValues[0] = 1.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 1.0;
+		np.maxSliders[0] = 240.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Resamplefilter";
+		sp.label = "Interpolation";
+		sp.page = "Output";
+		sp.defaultValue = "Cubic";
+
+		const char* names[] = { "Linear", "Cubic" };
+		const char* labels[] = { "Linear", "Cubic" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Antialias";
+		np.label = "Anti-Alias";
+		np.page = "Output";
+		np.defaultValues[0] = 1;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Async cook
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Async";
+		np.label = "Async Cook";
+		np.page = "Output";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Asynclatency";
+		np.label = "Async Latency (Frames)";
+		np.page = "Output";
+		np.defaultValues[0] = 1;
+		np.minValues[0] = 0;
+		np.maxValues[0] = 1;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 1;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Pose input
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Poseinput";
+		sp.label = "Pose Input";
+		sp.page = "Input";
+		sp.defaultValue = "Separate";
+
+		const char* names[] = { "Separate", "Packed", "Sop", "Top", "Cues" };
+		const char* labels[] = { "Separate Inputs", "Packed in Input 1", "SOP Points", "TOP Height Map", "Cues" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 5, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Packedlayout";
+		sp.label = "Packed Layout";
+		sp.page = "Input";
+		sp.defaultValue = "Auto";
+
+		const char* names[] = { "Auto", "Interleaved", "Grouped" };
+		const char* labels[] = { "Detect from Names", "Interleaved (h r p y per Fixture)", "Grouped by Kind" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Posesop";
+		sp.label = "Pose SOP";
+		sp.page = "Input";
+
+		OP_ParAppendResult res = manager->appendSOP(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Orientattrib";
+		sp.label = "Orientation Attribute";
+		sp.page = "Input";
+		sp.defaultValue = "";
+
+		OP_ParAppendResult res = manager->appendString(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Posetop";
+		sp.label = "Pose TOP";
+		sp.page = "Input";
+
+		OP_ParAppendResult res = manager->appendTOP(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Heightscale";
+		np.label = "Height Scale";
+		np.page = "Input";
+		np.defaultValues[0] = 1.0;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 5.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Heightoffset";
+		np.label = "Height Offset";
+		np.page = "Input";
+		np.defaultValues[0] = 0.0;
+		np.minSliders[0] = -5.0;
+		np.maxSliders[0] = 5.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Toptilt";
+		np.label = "Tilt from Slope";
+		np.page = "Input";
+		np.defaultValues[0] = 1;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Mapsize";
+		np.label = "Map Size";
+		np.page = "Input";
+		np.defaultValues[0] = 10.0;
+		np.defaultValues[1] = 10.0;
+		np.minValues[0] = np.minValues[1] = 0.001;
+		np.clampMins[0] = np.clampMins[1] = true;
+		np.minSliders[0] = np.minSliders[1] = 0.0;
+		np.maxSliders[0] = np.maxSliders[1] = 50.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np, 2);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Input smoothing
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Smoothmode";
+		sp.label = "Smoothing";
+		sp.page = "Smoothing";
+		sp.defaultValue = "Off";
+
+		const char* names[] = { "Off", "Oneeuro", "Spring", "Biquad" };
+		const char* labels[] = { "Off", "One Euro Filter", "Critically Damped Spring", "Biquad Low Pass" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 4, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Smoothmincutoff";
+		np.label = "One Euro Min Cutoff (Hz)";
+		np.page = "Smoothing";
+		np.defaultValues[0] = 1.0;
+		np.minValues[0] = 0.001;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 10.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Smoothbeta";
+		np.label = "One Euro Beta";
+		np.page = "Smoothing";
+		np.defaultValues[0] = 0.5;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 5.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Smoothderivcutoff";
+		np.label = "One Euro Derivative Cutoff (Hz)";
+		np.page = "Smoothing";
+		np.defaultValues[0] = 1.0;
+		np.minValues[0] = 0.001;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 10.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Smoothspringtime";
+		np.label = "Spring Time (Seconds)";
+		np.page = "Smoothing";
+		np.defaultValues[0] = 0.1;
+		np.minValues[0] = 0.001;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 1.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Smoothcutoff";
+		np.label = "Biquad Cutoff (Hz)";
+		np.page = "Smoothing";
+		np.defaultValues[0] = 5.0;
+		np.minValues[0] = 0.001;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 30.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Smoothq";
+		np.label = "Biquad Q";
+		np.page = "Smoothing";
+		np.defaultValues[0] = 0.7071;
+		np.minValues[0] = 0.1;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.1;
+		np.maxSliders[0] = 4.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Pose prediction
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Predictmode";
+		sp.label = "Prediction";
+		sp.page = "Prediction";
+		sp.defaultValue = "Off";
+
+		const char* names[] = { "Off", "Velocity", "Acceleration", "Kalman" };
+		const char* labels[] = { "Off", "Constant Velocity", "Constant Acceleration", "Kalman Filter" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 4, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Predictlead";
+		np.label = "Lead Time (Seconds)";
+		np.page = "Prediction";
+		np.defaultValues[0] = 0.05;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 0.5;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Kalmanprocessnoise";
+		np.label = "Kalman Process Noise";
+		np.page = "Prediction";
+		np.defaultValues[0] = 50.0;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 1000.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Kalmanmeasurementnoise";
+		np.label = "Kalman Measurement Noise";
+		np.page = "Prediction";
+		np.defaultValues[0] = 0.01;
+		np.minValues[0] = 0.000001;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 1.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Safety envelope
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Safety";
+		np.label = "Safety Envelope";
+		np.page = "Safety";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Safeminheight";
+		np.label = "Motor Min Height";
+		np.page = "Safety";
+		np.defaultValues[0] = 0.5;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 5.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Safemaxheight";
+		np.label = "Motor Max Height";
+		np.page = "Safety";
+		np.defaultValues[0] = 3.0;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 5.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Safeknee";
+		np.label = "Soft Knee";
+		np.page = "Safety";
+		np.defaultValues[0] = 0.1;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 1.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Safemaxspread";
+		np.label = "Max Motor Spread";
+		np.page = "Safety";
+		np.defaultValues[0] = 1.0;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 2.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Safemaxspeed";
+		np.label = "Max Motor Speed";
+		np.page = "Safety";
+		np.defaultValues[0] = 1.0;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 5.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Closed loop
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Feedback";
+		np.label = "Closed Loop";
+		np.page = "Feedback";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Feedbackport";
+		np.label = "Feedback Port";
+		np.page = "Feedback";
+		np.defaultValues[0] = 7100;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 65535;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 65535;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Feedbacktimeout";
+		np.label = "Report Timeout (s)";
+		np.page = "Feedback";
+		np.defaultValues[0] = 0.5;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 2.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Feedbackkp";
+		np.label = "Proportional Gain";
+		np.page = "Feedback";
+		np.defaultValues[0] = 0.5;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 2.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Feedbackki";
+		np.label = "Integral Gain";
+		np.page = "Feedback";
+		np.defaultValues[0] = 1.0;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 10.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Feedbackkd";
+		np.label = "Derivative Gain";
+		np.page = "Feedback";
+		np.defaultValues[0] = 0.0;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 0.1;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Feedbackmax";
+		np.label = "Max Correction";
+		np.page = "Feedback";
+		np.defaultValues[0] = 0.2;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 1.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Collision avoidance
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Avoidcollisions";
+		np.label = "Avoid Collisions";
+		np.page = "Collision";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Fixtureradius";
+		np.label = "Fixture Radius";
+		np.page = "Collision";
+		np.defaultValues[0] = 0.5;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 2.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Clearance";
+		np.label = "Clearance";
+		np.page = "Collision";
+		np.defaultValues[0] = 0.05;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 0.5;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Collisioniterations";
+		np.label = "Iterations";
+		np.page = "Collision";
+		np.defaultValues[0] = 4;
+		np.minValues[0] = 1;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 16;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Gridspacing";
+		np.label = "Grid Spacing";
+		np.page = "Collision";
+		np.defaultValues[0] = 1.0;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 5.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Cues
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Cuedat";
+		sp.label = "Cue DAT";
+		sp.page = "Cues";
+
+		OP_ParAppendResult res = manager->appendDAT(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Cuefile";
+		sp.label = "Cue File";
+		sp.page = "Cues";
+
+		OP_ParAppendResult res = manager->appendFile(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Cuereload";
+		np.label = "Reload Cues";
+		np.page = "Cues";
+
+		OP_ParAppendResult res = manager->appendPulse(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Cue";
+		sp.label = "Cue";
+		sp.page = "Cues";
+
+		OP_ParAppendResult res = manager->appendString(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Cuefade";
+		np.label = "Fade Time (Seconds)";
+		np.page = "Cues";
+		np.defaultValues[0] = 2.0;
+		np.minValues[0] = 0.0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 10.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Cuefademode";
+		sp.label = "Fade Mode";
+		sp.page = "Cues";
+		sp.defaultValue = "Orientation";
+
+		const char* names[] = { "Motors", "Orientation" };
+		const char* labels[] = { "Motor Values", "Orientation" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Cuefine";
+		np.label = "16 Bit Fine Channels";
+		np.page = "Cues";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Baked show
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Bakefile";
+		sp.label = "Bake File";
+		sp.page = "Bake";
+
+		OP_ParAppendResult res = manager->appendFile(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Bake";
+		np.label = "Bake Show";
+		np.page = "Bake";
+
+		OP_ParAppendResult res = manager->appendPulse(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Bakedelta";
+		np.label = "Delta Compression";
+		np.page = "Bake";
+		np.defaultValues[0] = 1;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Bakekeyframe";
+		np.label = "Keyframe Interval";
+		np.page = "Bake";
+		np.defaultValues[0] = 60;
+		np.minValues[0] = 1;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 600;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Bakeplay";
+		np.label = "Play Baked Show";
+		np.page = "Bake";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Playkey";
+		sp.label = "Play By";
+		sp.page = "Bake";
+		sp.defaultValue = "Timeline";
+
+		const char* names[] = { "Timeline", "Index" };
+		const char* labels[] = { "Timeline Frame", "Play Index" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Playindex";
+		np.label = "Play Index";
+		np.page = "Bake";
+		np.defaultValues[0] = 0;
+		np.minValues[0] = 0;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 10000;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Recording
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Recordfile";
+		sp.label = "Record File";
+		sp.page = "Bake";
+
+		OP_ParAppendResult res = manager->appendFile(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Record";
+		np.label = "Record";
+		np.page = "Bake";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Recordbuffer";
+		np.label = "Record Buffer (Frames)";
+		np.page = "Bake";
+		np.defaultValues[0] = 240;
+		np.minValues[0] = 2;
+		np.clampMins[0] = true;
+		np.minSliders[0] = 2;
+		np.maxSliders[0] = 1000;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Send
 
 	{
 		OP_NumericParameter np;
-		np.name = "Basesize";
-		np.label = "Base Size";
-		np.defaultValues[0] = 1.0;
-		np.minSliders[0] = 0.1;
-		np.maxSliders[0] = 5.0;
-		OP_ParAppendResult res = manager->appendFloat(np);
+
+		np.name = "Send";
+		np.label = "Send";
+		np.page = "Send";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
 	{
-		OP_NumericParameter np;
-		np.name = "Minheight";
-		np.label = "Min Height";
-		np.defaultValues[0] = 0.5;
-		np.minSliders[0] = 0.0;
-		np.maxSliders[0] = 1.0;
-		OP_ParAppendResult res = manager->appendFloat(np);
+		OP_StringParameter sp;
+
+		sp.name = "Sendprotocol";
+		sp.label = "Send Protocol";
+		sp.page = "Send";
+		sp.defaultValue = "Artnet";
+
+		const char* names[] = { "Artnet", "Sacn", "Enttec" };
+		const char* labels[] = { "Art-Net", "sACN (E1.31)", "ENTTEC DMX USB Pro" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Sendhost";
+		sp.label = "Destination";
+		sp.page = "Send";
+		sp.defaultValue = "255.255.255.255";
+
+		OP_ParAppendResult res = manager->appendString(sp);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
 	{
 		OP_NumericParameter np;
-		np.name = "Maxheight";
-		np.label = "Max Height";
-		np.defaultValues[0] = 3.0;
+
+		np.name = "Sendrate";
+		np.label = "Send Rate (Hz)";
+		np.page = "Send";
+		np.defaultValues[0] = 40.0;
+		np.minValues[0] = 1.0;
+		np.clampMins[0] = true;
 		np.minSliders[0] = 1.0;
-		np.maxSliders[0] = 10.0;
+		np.maxSliders[0] = 100.0;
+
 		OP_ParAppendResult res = manager->appendFloat(np);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
+	{
+		OP_NumericParameter np;
+
+		np.name = "Receive";
+		np.label = "Loopback Receiver";
+		np.page = "Send";
+		np.defaultValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter np;
+
+		np.name = "Receiveport";
+		np.label = "Receive Port";
+		np.page = "Send";
+		np.defaultValues[0] = 6454;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 65535;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 65535;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+}
+
+void 
+CPlusPlusCHOPExample::pulsePressed(const char* name, void* reserved1)
+{
+	if (!strcmp(name, "Reset"))
+	{
+		myOffset = 0.0;
+	}
+
+	// Baking needs the inputs, so it runs in the next getOutputInfo()
+	if (!strcmp(name, "Bake"))
+	{
+		myBakePending = true;
+	}
+
+	if (!strcmp(name, "Cuereload"))
+	{
+		myCueReload = true;
+	}
+}
+
+
+// Motor base class constructor
+Motor::Motor(MotorType t, uint8_t* channels) : type(t), dmxChannels(channels), numChannels(channelCount(t)) {}
+
+int Motor::channelCount(MotorType t) {
+	return t == NINE_CH ? 9 : t == TEN_CH ? 10 : 62;
+}
+
+// Clamp DMX values to the 0-255 range
+int Motor::clamp(int value) { return (value < 0) ? 0 : (value > 255) ? 255 : value; }
+
+// Set a specific DMX channel's value
+void Motor::setChannel(int channel, uint8_t value) {
+	if (channel >= 1 && channel <= numChannels)
+		dmxChannels[channel - 1] = static_cast<uint8_t>(clamp(value));
+}
+
+// Get a specific DMX channel's value
+int Motor::getChannel(int channel) const {
+	return (channel >= 1 && channel <= numChannels) ? dmxChannels[channel - 1] : 0;
+}
+
+// Print all DMX channel values for the motor
+void Motor::printStatus() const {
+	std::cout << (type == NINE_CH ? "9CH" : type == TEN_CH ? "10CH" : "62CH") << " Motor - ";
+	for (int i = 0; i < numChannels; i++) {
+		std::cout << "CH" << i + 1 << ": " << (int)dmxChannels[i] << " ";
+	}
+	std::cout << std::endl;
+}
+
+// 9CH Motor constructor
+Motor9CH::Motor9CH(uint8_t* channels) : Motor(NINE_CH, channels) {}
+
+void Motor9CH::printStatus() const {
+	std::cout << "9CH Motor - ";
+	Motor::printStatus();
+}
+
+// 10CH Motor constructor
+Motor10CH::Motor10CH(uint8_t* channels) : Motor(TEN_CH, channels) {}
+
+void Motor10CH::printStatus() const {
+	std::cout << "10CH Motor - ";
+	Motor::printStatus();
+}
+
+// 62CH Motor constructor
+Motor62CH::Motor62CH(uint8_t* channels) : Motor(SIXTY_TWO_CH, channels) {}
+
+void Motor62CH::printStatus() const {
+	std::cout << "62CH Motor - ";
+	Motor::printStatus();
+}
+
+
+KineticLight::KineticLight(Motor* m1, Motor* m2, Motor* m3, uint8_t* s)
+	: motor1(m1), motor2(m2), motor3(m3), slots(s) {}
+
+void KineticLight::setMotorChannel(int motorIndex, int channel, uint8_t value) {
+	if (motorIndex == 1) motor1->setChannel(channel, value);
+	else if (motorIndex == 2) motor2->setChannel(channel, value);
+	else if (motorIndex == 3) motor3->setChannel(channel, value);
+}
+
+void KineticLight::printStatus() const {
+	std::cout << "Kinetic Light Status:" << std::endl;
+	motor1->printStatus();
+	motor2->printStatus();
+	motor3->printStatus();
+}
+
+const Motor* KineticLight::getMotor(int index) const {
+	switch (index) {
+	case 1: return motor1;
+	case 2: return motor2;
+	case 3: return motor3;
+	default: return nullptr;
+	}
+}
+
+void KineticLight::setSlot(int slot, uint8_t value) {
+	if (slot >= 1 && slot <= NUM_SLOTS) slots[slot - 1] = value;
+}
+
+int KineticLight::getSlot(int slot) const {
+	return (slot >= 1 && slot <= NUM_SLOTS) ? slots[slot - 1] : 0;
+}
+
+int KineticLight::motorSlot(int motorIndex) {
+	static const int slots[3] = { 1, 63, 72 };
+	return motorIndex >= 1 && motorIndex <= 3 ? slots[motorIndex - 1] : 0;
+}
+
+bool KineticLight::isMotionSlot(int slot) {
+	return (slot >= 1 && slot <= 3) || (slot >= 63 && slot <= 65) || (slot >= 72 && slot <= 74);
+}
+
+
+// The arena lays motors out with a fixed stride
+static_assert(sizeof(Motor9CH) == sizeof(Motor) && sizeof(Motor10CH) == sizeof(Motor) && sizeof(Motor62CH) == sizeof(Motor),
+	"Motor types must not add data members");
+
+FixtureArena::FixtureArena() : lights(nullptr), motorStorage(nullptr), count(0), capacity(0) {}
+
+FixtureArena::~FixtureArena() {
+	destroy();
+}
+
+void FixtureArena::reset(size_t numFixtures) {
+	destroy();
+	if (numFixtures > capacity) {
+		objects.reset(new unsigned char[numFixtures * (sizeof(KineticLight) + 3 * sizeof(Motor))]);
+		slots.reset(new uint8_t[numFixtures * KineticLight::NUM_SLOTS]);
+		capacity = numFixtures;
+	}
+	lights = reinterpret_cast<KineticLight*>(objects.get());
+	motorStorage = objects.get() + capacity * sizeof(KineticLight);
+	if (numFixtures)
+		memset(slots.get(), 0, numFixtures * KineticLight::NUM_SLOTS);
+
+	for (size_t f = 0; f < numFixtures; f++) {
+		uint8_t* fixtureSlots = slots.get() + f * KineticLight::NUM_SLOTS;
+		unsigned char* motor = motorStorage + f * 3 * sizeof(Motor);
+
+		// Initialize KineticLight with appropriate motor types
+		Motor* m1 = new (motor) Motor62CH(fixtureSlots);						// First motor (62CH)
+		Motor* m2 = new (motor + sizeof(Motor)) Motor9CH(fixtureSlots + 62);		// Second motor (9CH)
+		Motor* m3 = new (motor + 2 * sizeof(Motor)) Motor9CH(fixtureSlots + 71);	// Third motor (9CH)
+		new (lights + f) KineticLight(m1, m2, m3, fixtureSlots);
+	}
+	count = numFixtures;
+}
+
+void FixtureArena::destroy() {
+	for (size_t f = 0; f < count; f++) {
+		lights[f].~KineticLight();
+		for (int m = 0; m < 3; m++)
+			reinterpret_cast<Motor*>(motorStorage + (f * 3 + m) * sizeof(Motor))->~Motor();
+	}
+	count = 0;
+}
+
+PoseSmoother::PoseSmoother() : numChannels(0), primed(false), lastMode(SmoothMode::Off) {}
+
+void PoseSmoother::resize(size_t channels) {
+	numChannels = channels;
+	primed = false;
+	euroValue.assign(channels, 0.0f);
+	euroDerivative.assign(channels, 0.0f);
+	springValue.assign(channels, 0.0f);
+	springVelocity.assign(channels, 0.0f);
+	biquadZ1.assign(channels, 0.0f);
+	biquadZ2.assign(channels, 0.0f);
+}
+
+// Smoothing factor of a one pole low-pass at 'cutoff' Hz
+static inline float lowPassAlpha(float cutoff, float dt) {
+	float tau = 1.0f / (2.0f * static_cast<float>(PI) * cutoff);
+	return 1.0f / (1.0f + tau / dt);
+}
+
+struct BiquadCoefficients {
+	float b0, b1, b2, a1, a2;
+};
+
+// RBJ cookbook low-pass, normalized by a0. The cutoff is kept below Nyquist.
+static BiquadCoefficients biquadLowPass(float cutoff, float q, float dt) {
+	const float w = 2.0f * static_cast<float>(PI) * std::min(cutoff * dt, 0.45f);
+	const float alpha = std::sin(w) / (2.0f * q);
+	const float a0 = 1.0f + alpha;
+	BiquadCoefficients k;
+	k.b1 = (1.0f - std::cos(w)) / a0;
+	k.b0 = k.b2 = k.b1 * 0.5f;
+	k.a1 = -2.0f * std::cos(w) / a0;
+	k.a2 = (1.0f - alpha) / a0;
+	return k;
+}
+
+void PoseSmoother::process(const float* samples, int numSamples, float dt, const SmoothingParams& params, float* out) {
+	const size_t n = numChannels;
+	const size_t total = static_cast<size_t>(std::max(numSamples, 0)) * n;
+	if (params.mode != lastMode) {
+		lastMode = params.mode;
+		primed = false;
+	}
+	if (params.mode == SmoothMode::Off || dt <= 0.0f || !n) {
+		std::copy(samples, samples + total, out);
+		return;
+	}
+
+	// Start every filter at rest on the first sample
+	if (!primed && numSamples > 0) {
+		for (size_t c = 0; c < n; c++) {
+			euroValue[c] = springValue[c] = samples[c];
+			euroDerivative[c] = springVelocity[c] = 0.0f;
+		}
+		primed = true;
+		if (params.mode == SmoothMode::Biquad) {
+			// Settle the delay line as if the first sample had always been there
+			BiquadCoefficients k = biquadLowPass(params.cutoff, params.q, dt);
+			for (size_t c = 0; c < n; c++) {
+				biquadZ2[c] = (k.b2 - k.a2) * samples[c];
+				biquadZ1[c] = (k.b1 - k.a1) * samples[c] + biquadZ2[c];
+			}
+		}
+	}
+
+	switch (params.mode) {
+	case SmoothMode::OneEuro: {
+		float* x = euroValue.data();
+		float* dx = euroDerivative.data();
+		const float invDt = 1.0f / dt;
+		const float derivativeAlpha = lowPassAlpha(params.derivativeCutoff, dt);
+		const float tauScale = 1.0f / (2.0f * static_cast<float>(PI));
+		for (int s = 0; s < numSamples; s++) {
+			const float* z = samples + static_cast<size_t>(s) * n;
+			float* y = out + static_cast<size_t>(s) * n;
+			for (size_t c = 0; c < n; c++) {
+				// The cutoff rises with speed, so fast moves lag less than slow jitter is smoothed
+				dx[c] += derivativeAlpha * ((z[c] - x[c]) * invDt - dx[c]);
+				float cutoff = params.minCutoff + params.beta * std::fabs(dx[c]);
+				float alpha = 1.0f / (1.0f + tauScale / (cutoff * dt));
+				x[c] += alpha * (z[c] - x[c]);
+				y[c] = x[c];
+			}
+		}
+		break;
+	}
+	case SmoothMode::Spring: {
+		float* x = springValue.data();
+		float* v = springVelocity.data();
+		const float omega = 2.0f / params.springTime;
+		const float k = omega * dt;
+		const float decay = 1.0f / (1.0f + k + 0.48f * k * k + 0.235f * k * k * k);
+		for (int s = 0; s < numSamples; s++) {
+			const float* z = samples + static_cast<size_t>(s) * n;
+			float* y = out + static_cast<size_t>(s) * n;
+			for (size_t c = 0; c < n; c++) {
+				float change = x[c] - z[c];
+				float temp = (v[c] + omega * change) * dt;
+				v[c] = (v[c] - omega * temp) * decay;
+				x[c] = z[c] + (change + temp) * decay;
+				y[c] = x[c];
+			}
+		}
+		break;
+	}
+	case SmoothMode::Biquad: {
+		float* z1 = biquadZ1.data();
+		float* z2 = biquadZ2.data();
+		const BiquadCoefficients k = biquadLowPass(params.cutoff, params.q, dt);
+		for (int s = 0; s < numSamples; s++) {
+			const float* z = samples + static_cast<size_t>(s) * n;
+			float* y = out + static_cast<size_t>(s) * n;
+			for (size_t c = 0; c < n; c++) {
+				float result = k.b0 * z[c] + z1[c];
+				z1[c] = k.b1 * z[c] - k.a1 * result + z2[c];
+				z2[c] = k.b2 * z[c] - k.a2 * result;
+				y[c] = result;
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+PosePredictor::PosePredictor() : numChannels(0), samplesSeen(0), lastMode(PredictMode::Off) {}
+
+void PosePredictor::resize(size_t channels) {
+	numChannels = channels;
+	samplesSeen = 0;
+	value.assign(channels, 0.0f);
+	velocity.assign(channels, 0.0f);
+	acceleration.assign(channels, 0.0f);
+	p00.assign(channels, 0.0f);
+	p01.assign(channels, 0.0f);
+	p11.assign(channels, 0.0f);
+}
+
+void PosePredictor::process(const float* samples, int numSamples, float dt, float lead, PredictMode mode,
+							float processNoise, float measurementNoise, float* out) {
+	const size_t n = numChannels;
+	if (numSamples < 1 || !n)
+		return;
+
+	const float* newest = samples + static_cast<size_t>(numSamples - 1) * n;
+	if (mode != lastMode) {
+		lastMode = mode;
+		samplesSeen = 0;
+	}
+	if (mode == PredictMode::Off || dt <= 0.0f) {
+		std::copy(newest, newest + n, out);
+		return;
+	}
+
+	float* x = value.data();
+	float* v = velocity.data();
+	float* a = acceleration.data();
+	const float invDt = 1.0f / dt;
+
+	// Kalman noise terms for a constant velocity model driven by white noise acceleration
+	const float q00 = processNoise * dt * dt * dt * dt * 0.25f;
+	const float q01 = processNoise * dt * dt * dt * 0.5f;
+	const float q11 = processNoise * dt * dt;
+	const float r = measurementNoise;
+
+	for (int s = 0; s < numSamples; s++) {
+		const float* z = samples + static_cast<size_t>(s) * n;
+
+		if (samplesSeen == 0) {
+			// Start at rest on the first sample
+			for (size_t c = 0; c < n; c++) {
+				x[c] = z[c];
+				v[c] = 0.0f;
+				a[c] = 0.0f;
+				p00[c] = r;
+				p01[c] = 0.0f;
+				p11[c] = r * invDt * invDt;
+			}
+		}
+		else if (mode == PredictMode::Kalman) {
+			float* P00 = p00.data();
+			float* P01 = p01.data();
+			float* P11 = p11.data();
+			for (size_t c = 0; c < n; c++) {
+				// Predict
+				float px = x[c] + v[c] * dt;
+				float pp00 = P00[c] + dt * (2.0f * P01[c] + dt * P11[c]) + q00;
+				float pp01 = P01[c] + dt * P11[c] + q01;
+				float pp11 = P11[c] + q11;
+
+				// Correct
+				float k0 = pp00 / (pp00 + r);
+				float k1 = pp01 / (pp00 + r);
+				float y = z[c] - px;
+				x[c] = px + k0 * y;
+				v[c] += k1 * y;
+				P00[c] = (1.0f - k0) * pp00;
+				P01[c] = (1.0f - k0) * pp01;
+				P11[c] = pp11 - k1 * pp01;
+			}
+		}
+		else {
+			// Finite differences; acceleration needs a second velocity
+			const float accelerationWeight = samplesSeen > 1 ? 1.0f : 0.0f;
+			for (size_t c = 0; c < n; c++) {
+				float nv = (z[c] - x[c]) * invDt;
+				a[c] = (nv - v[c]) * invDt * accelerationWeight;
+				v[c] = nv;
+				x[c] = z[c];
+			}
+		}
+		samplesSeen++;
+	}
+
+	if (mode == PredictMode::Acceleration) {
+		const float halfLeadSq = 0.5f * lead * lead;
+		for (size_t c = 0; c < n; c++)
+			out[c] = x[c] + v[c] * lead + a[c] * halfLeadSq;
+	}
+	else {
+		for (size_t c = 0; c < n; c++)
+			out[c] = x[c] + v[c] * lead;
+	}
+}
+
+void SafetyEnvelope::resize(size_t fixtures) {
+	last.resize(fixtures * 3, 0.0f);
+	primed.resize(fixtures, 0);
+}
+
+void SafetyEnvelope::process(float* heights, size_t count, float elapsed, const SafetyLimits& limits, uint8_t* hits) {
+	// Within the knee of a height limit, the distance past the knee's start
+	// is compressed so motors ease into the limit without ever reaching it
+	const float knee = clamp(limits.softKnee, 1e-6f, std::max((limits.maxHeight - limits.minHeight) * 0.5f, 1e-6f));
+	const float lower = limits.minHeight + knee;
+	const float upper = limits.maxHeight - knee;
+	const float maxSpread = std::max(limits.maxSpread, 0.0f);
+	const float limitedStep = elapsed > 0.0f ? limits.maxSpeed * elapsed : HUGE_VALF;
+	float* previous = last.data();
+
+	// One fixture at a time without branches, so the loop vectorizes. Each
+	// stage keeps what the one before enforced: the spread and height limits
+	// hold for both the last and the new heights, so does every step in between.
+	for (size_t f = 0; f < count; f++) {
+		float* h = heights + f * 3;
+		float* l = previous + f * 3;
+
+		// Pull the motors towards their mean, keeping the direction of the tilt
+		float mean = (h[0] + h[1] + h[2]) / 3.0f;
+		float spread = std::max(std::max(h[0], h[1]), h[2]) - std::min(std::min(h[0], h[1]), h[2]);
+		float tilt = spread > maxSpread ? maxSpread / spread : 1.0f;
+		uint8_t hit = tilt < 1.0f ? LIMIT_SPREAD : 0;
+		for (int m = 0; m < 3; m++)
+			h[m] = mean + (h[m] - mean) * tilt;
+
+		for (int m = 0; m < 3; m++) {
+			float over = std::max(h[m] - upper, 0.0f);
+			float under = std::max(lower - h[m], 0.0f);
+			hit |= over > 0.0f || under > 0.0f ? LIMIT_HEIGHT : 0;
+			h[m] += under * under / (under + knee) - over * over / (over + knee);
+		}
+
+		// Scale the whole step down to the fastest motor's limit
+		float maxStep = primed[f] ? limitedStep : HUGE_VALF;
+		float step = std::max(std::max(fabsf(h[0] - l[0]), fabsf(h[1] - l[1])), fabsf(h[2] - l[2]));
+		float speed = step > maxStep ? maxStep / step : 1.0f;
+		hit |= speed < 1.0f ? LIMIT_SPEED : 0;
+		for (int m = 0; m < 3; m++) {
+			h[m] = l[m] + (h[m] - l[m]) * speed;
+			l[m] = h[m];
+		}
+		hits[f] |= hit;
+		primed[f] = 1;
+	}
+}
+
+void FeedbackCorrector::resize(size_t motors) {
+	integral.assign(motors, 0.0f);
+	lastError.assign(motors, 0.0f);
+	lastFresh.assign(motors, 0.0f);
+	lastTime.assign(motors, 0);
+	interval.assign(motors, 0.0f);
+}
+
+float FeedbackCorrector::process(float* heights, const float* measured, const float* fresh, const int64_t* times,
+								 size_t count, float elapsed, const FeedbackParams& params) {
+	count = std::min(count, integral.size());
+	const float limit = std::max(params.maxCorrection, 0.0f);
+	const float maxInterval = std::max(params.timeout, 0.0f);
+	elapsed = std::max(elapsed, 0.0f);
+	float* integral = this->integral.data();
+	float* lastError = this->lastError.data();
+	float* lastFresh = this->lastFresh.data();
+	int64_t* lastTime = this->lastTime.data();
+	float* interval = this->interval.data();
+
+	// The proportional term follows every cook's target. The integral and
+	// derivative only move when a new report arrives, over the time since
+	// the report before it, capped at the timeout so the first report after
+	// a gap doesn't integrate the gap. The integral holds its share of the
+	// correction, clamped so it can't wind up past the largest correction
+	// while a motor can't follow. The derivative only compares fresh
+	// reports in a row, so the first report after a gap doesn't kick the
+	// motor against a stale error.
+	float errorSum = 0.0f;
+	float freshCount = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		float error = (heights[i] - measured[i]) * fresh[i];
+		float updated = times[i] != lastTime[i] ? fresh[i] : 0.0f;
+		lastTime[i] = times[i];
+		interval[i] += elapsed;
+		float dt = std::min(interval[i], maxInterval);
+		float rate = dt > 0.0f ? 1.0f / dt : 0.0f;
+		integral[i] = std::min(std::max(integral[i] + params.ki * dt * error * updated, -limit), limit);
+		float derivative = (error - lastError[i]) * rate * updated * lastFresh[i];
+		float correction = params.kp * error + integral[i] + params.kd * derivative;
+		lastError[i] += (error - lastError[i]) * updated;
+		lastFresh[i] = fresh[i];
+		interval[i] *= 1.0f - updated;
+		heights[i] += std::min(std::max(correction, -limit), limit);
+		errorSum += std::abs(error);
+		freshCount += fresh[i];
+	}
+	return freshCount > 0.0f ? errorSum / freshCount : 0.0f;
+}
+
+FrameArena::FrameArena() : capacity(0), used(0), highWater(0), shortfall(0) {}
+
+void FrameArena::reserve(size_t bytes) {
+	if (shortfall) {
+		bytes = std::max(bytes, capacity + shortfall);
+		shortfall = 0;
+	}
+	if (bytes <= capacity)
+		return;
+	block.reset(new unsigned char[bytes]);
+	capacity = bytes;
+	used = 0;
+}
+
+void* FrameArena::allocBytes(size_t bytes, size_t alignment) {
+	size_t offset = (used + alignment - 1) & ~(alignment - 1);
+	if (offset + bytes > capacity) {
+		shortfall = std::max(shortfall.load(), offset + bytes - capacity);
+		return nullptr;
+	}
+	used = offset + bytes;
+	highWater = std::max(highWater, used);
+	return block.get() + offset;
+}
+
+MappedFile::MappedFile() : bytes(nullptr), length(0)
+#ifdef _WIN32
+	, file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+{}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const char* path) {
+	close();
+#ifdef _WIN32
+	file = CreateFileW(widePath(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER fileSize;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+		close();
+		return false;
+	}
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view) {
+		close();
+		return false;
+	}
+	bytes = static_cast<const uint8_t*>(view);
+	length = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	void* view = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+		view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+	bytes = static_cast<const uint8_t*>(view);
+	length = static_cast<size_t>(info.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (bytes)
+		UnmapViewOfFile(bytes);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+#else
+	if (bytes)
+		munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+	bytes = nullptr;
+	length = 0;
+}
+
+BakeWriter::BakeWriter() : header(), delta(false), offset(0) {}
+
+bool BakeWriter::open(const char* path, size_t numFixtures, uint32_t keyframeInterval, bool delta,
+					  double startIndex, double sampleRate) {
+#ifdef _WIN32
+	file.open(widePath(path), std::ios::binary | std::ios::trunc);
+#else
+	file.open(path, std::ios::binary | std::ios::trunc);
+#endif
+	header = BakeHeader();
+	memcpy(header.magic, BAKE_MAGIC, sizeof(header.magic));
+	header.version = BAKE_VERSION;
+	header.numFixtures = static_cast<uint32_t>(numFixtures);
+	header.keyframeInterval = std::max<uint32_t>(keyframeInterval, 1);
+	header.startIndex = startIndex;
+	header.sampleRate = sampleRate;
+	this->delta = delta;
+	offset = sizeof(header);
+	index.clear();
+	previous.assign(numFixtures * KineticLight::NUM_SLOTS, 0);
+
+	// The header is written again by close(), once the index is known
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return static_cast<bool>(file);
+}
+
+bool BakeWriter::write(const uint8_t* slots) {
+	size_t numSlots = previous.size();
+	BakeFrameEntry entry = { offset, static_cast<uint32_t>(numSlots), 0 };
+	const uint8_t* data = slots;
+	if (delta && index.size() % header.keyframeInterval != 0) {
+		encodeBakeDelta(previous.data(), slots, numSlots, encoded);
+		if (encoded.size() < numSlots) {
+			data = encoded.data();
+			entry.size = static_cast<uint32_t>(encoded.size());
+			entry.delta = 1;
+		}
+	}
+	file.write(reinterpret_cast<const char*>(data), entry.size);
+	offset += entry.size;
+	index.push_back(entry);
+	memcpy(previous.data(), slots, numSlots);
+	return static_cast<bool>(file);
+}
+
+bool BakeWriter::close() {
+	// The index is read in place from the mapped file, so it's aligned
+	const char padding[alignof(BakeFrameEntry)] = {};
+	size_t paddingBytes = (alignof(BakeFrameEntry) - offset % alignof(BakeFrameEntry)) % alignof(BakeFrameEntry);
+	file.write(padding, paddingBytes);
+	header.numFrames = static_cast<uint32_t>(index.size());
+	header.indexOffset = offset + paddingBytes;
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(BakeFrameEntry));
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.close();
+	return !file.fail();
+}
+
+FrameRing::FrameRing() : frameBytes(0), capacity(0), head(0), tail(0) {}
+
+void FrameRing::reset(size_t bytes, size_t numFrames) {
+	if (bytes * numFrames != frameBytes * capacity)
+		storage.reset(new uint8_t[bytes * numFrames]);
+	if (numFrames != capacity || !numbers)
+		numbers.reset(new uint64_t[numFrames]);
+	frameBytes = bytes;
+	capacity = numFrames;
+	head = 0;
+	tail = 0;
+}
+
+bool FrameRing::push(const uint8_t* frame, uint64_t number) {
+	uint64_t h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) >= capacity)
+		return false;
+	memcpy(storage.get() + (h % capacity) * frameBytes, frame, frameBytes);
+	numbers[h % capacity] = number;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+const uint8_t* FrameRing::front(uint64_t* number) const {
+	uint64_t t = tail.load(std::memory_order_relaxed);
+	if (t == head.load(std::memory_order_acquire))
+		return nullptr;
+	*number = numbers[t % capacity];
+	return storage.get() + (t % capacity) * frameBytes;
+}
+
+void FrameRing::pop() {
+	tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+FrameRecorder::FrameRecorder()
+	: numFixtures(0), keyframeInterval(1), delta(false), startIndex(0.0), sampleRate(0.0), recording(false),
+	  quit(false), finished(false), failed(false), framesPushed(0), framesWritten(0), framesDropped(0) {}
+
+FrameRecorder::~FrameRecorder() {
+	stop();
+	if (writer.joinable())
+		writer.join();
+}
+
+bool FrameRecorder::start(const char* path, size_t numFixtures, size_t ringFrames, uint32_t keyframeInterval,
+						  bool delta, double startIndex, double sampleRate) {
+	if (recording || isWriting())
+		return false;
+	if (writer.joinable())
+		writer.join();
+
+	this->path = path;
+	this->numFixtures = numFixtures;
+	this->keyframeInterval = keyframeInterval;
+	this->delta = delta;
+	this->startIndex = startIndex;
+	this->sampleRate = sampleRate;
+	ring.reset(numFixtures * KineticLight::NUM_SLOTS, std::max<size_t>(ringFrames, 1));
+	zeros.assign(numFixtures * KineticLight::NUM_SLOTS, 0);
+
+	quit = false;
+	finished = false;
+	failed = false;
+	framesPushed = 0;
+	framesWritten = 0;
+	framesDropped = 0;
+	recording = true;
+	writer = std::thread(&FrameRecorder::writerLoop, this);
+	return true;
+}
+
+void FrameRecorder::stop() {
+	if (!recording)
+		return;
+	recording = false;
+	quit = true;
+	wake.notify_one();
+}
 
-	// pitch
-	{
-		OP_NumericParameter np;
+void FrameRecorder::push(const uint8_t* slots) {
+	if (!recording)
+		return;
+	uint64_t number = framesPushed.load(std::memory_order_relaxed);
+	if (!ring.push(slots ? slots : zeros.data(), number))
+		framesDropped++;
+	framesPushed.store(number + 1, std::memory_order_release);
+	wake.notify_one();
+}
 
-		np.name = "Minpitch";
-		np.label = "Min Pitch";
-		np.defaultValues[0] = -45.0;
-		np.minSliders[0] = -90.0;
-		np.maxSliders[0] = 90.0;
+void FrameRecorder::writerLoop() {
+	BakeWriter file;
+	bool ok = file.open(path.c_str(), numFixtures, keyframeInterval, delta, startIndex, sampleRate);
+	failed = !ok;
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
+	// The last frame written, repeated in place of the frames dropped after it
+	std::vector<uint8_t> previous(numFixtures * KineticLight::NUM_SLOTS, 0);
+	auto holdUntil = [&](uint64_t number) {
+		while (ok && framesWritten < number && (ok = file.write(previous.data())))
+			framesWritten++;
+	};
+	for (;;) {
+		// Everything pushed before stop() is in the ring once quit is seen
+		bool stopping = quit;
+		uint64_t number;
+		for (const uint8_t* frame = ring.front(&number); frame; frame = ring.front(&number)) {
+			holdUntil(number);
+			if (ok && (ok = file.write(frame))) {
+				framesWritten++;
+				memcpy(previous.data(), frame, previous.size());
+			}
+			ring.pop();
+		}
+		if (stopping)
+			holdUntil(framesPushed.load(std::memory_order_acquire));
+		failed = !ok;
+		if (stopping)
+			break;
+
+		// Pushes wake the writer, the timeout covers a wake-up missed while draining
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait_for(lock, std::chrono::milliseconds(10));
 	}
+	failed = !(file.close() && ok);
+	finished = true;
+}
 
-	{
-		OP_NumericParameter np;
+// ArtDmx packet: "Art-Net" ID, OpCode 0x5000, protocol version 14,
+// sequence, physical port, port address and data length, then the slots
+const size_t ARTDMX_HEADER_SIZE = 18;
+const uint16_t ARTNET_PORT = 6454;
 
-		np.name = "Maxpitch";
-		np.label = "Max Pitch";
-		np.defaultValues[0] = 45.0;
-		np.minSliders[0] = -90.0;
-		np.maxSliders[0] = 90.0;
+// sACN data packet: root, framing and DMP layers, then the start code and slots
+const size_t SACN_HEADER_SIZE = 126;
+const size_t SACN_SEQUENCE_OFFSET = 111;
+const uint16_t SACN_PORT = 5568;
+static const uint8_t theSacnIdentifier[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
-	}
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+#else
+typedef int SocketHandle;
+#endif
 
-	// roll
-	{
-		OP_NumericParameter np;
+// Opens an IPv4 UDP socket, returning -1 on failure. Each socket opened
+// has to be closed with closeUDPSocket().
+static intptr_t openUDPSocket() {
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return -1;
+#endif
+	intptr_t handle = static_cast<intptr_t>(::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+#ifdef _WIN32
+	if (handle == -1)
+		WSACleanup();
+#endif
+	return handle;
+}
 
-		np.name = "Minroll";
-		np.label = "Min Roll";
-		np.defaultValues[0] = -45.0;
-		np.minSliders[0] = -90.0;
-		np.maxSliders[0] = 90.0;
+static void closeUDPSocket(intptr_t handle) {
+#ifdef _WIN32
+	closesocket(static_cast<SocketHandle>(handle));
+	WSACleanup();
+#else
+	::close(static_cast<SocketHandle>(handle));
+#endif
+}
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
-	}
+// Makes a receive blocked on 'handle' in another thread return. Windows
+// only cancels it by closing the socket, and then returns true, elsewhere
+// shutdown() does and the socket is left to be closed.
+static bool wakeUDPSocket(intptr_t handle) {
+#ifdef _WIN32
+	closesocket(static_cast<SocketHandle>(handle));
+	WSACleanup();
+	return true;
+#else
+	shutdown(static_cast<SocketHandle>(handle), SHUT_RDWR);
+	return false;
+#endif
+}
 
-	{
-		OP_NumericParameter np;
+// FNV-1a hash of a universe's slots
+static uint32_t hashSlots(const uint8_t* slots, size_t count) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < count; i++)
+		hash = (hash ^ slots[i]) * 16777619u;
+	return hash;
+}
 
-		np.name = "Maxroll";
-		np.label = "Max Roll";
-		np.defaultValues[0] = 45.0;
-		np.minSliders[0] = -90.0;
-		np.maxSliders[0] = 90.0;
+static int64_t steadyNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
-	}
+SendLog::SendLog() : numUniverses(0) {}
 
-	// yaw
+void SendLog::reset(int32_t numUniverses) {
+	this->numUniverses = numUniverses;
+	times.reset(new std::atomic<int64_t>[256]);
+	hashes.reset(new std::atomic<uint32_t>[256 * static_cast<size_t>(numUniverses)]);
+	for (int i = 0; i < 256; i++)
+		times[i] = 0;
+}
 
-	{
-		OP_NumericParameter np;
+void SendLog::record(uint8_t sequence, const uint8_t* universes, int64_t time) {
+	// A receiver reading an entry while it's rewritten, for a packet a whole
+	// run of sequence numbers late, sees a mismatch at worst
+	std::atomic<uint32_t>* entry = &hashes[sequence * static_cast<size_t>(numUniverses)];
+	for (int32_t u = 0; u < numUniverses; u++)
+		entry[u].store(hashSlots(universes + static_cast<size_t>(u) * DMX_UNIVERSE_SIZE, DMX_UNIVERSE_SIZE), std::memory_order_relaxed);
+	times[sequence].store(time, std::memory_order_release);
+}
 
-		np.name = "Minyaw";
-		np.label = "Min Yaw";
-		np.defaultValues[0] = -45.0;
-		np.minSliders[0] = -90.0;
-		np.maxSliders[0] = 90.0;
+bool SendLog::lookup(uint8_t sequence, int32_t universe, int64_t& time, uint32_t& hash) const {
+	if (!times || universe < 0 || universe >= numUniverses)
+		return false;
+	time = times[sequence].load(std::memory_order_acquire);
+	hash = hashes[sequence * static_cast<size_t>(numUniverses) + universe].load(std::memory_order_relaxed);
+	return time != 0;
+}
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
+DMXSocket::DMXSocket()
+	: handle(-1), numUniverses(0), packetSize(0), sequenceOffset(0), slotsOffset(0), batched(false) {}
+
+DMXSocket::~DMXSocket() {
+	close();
+}
+
+bool DMXSocket::open(DMXProtocol protocol, const char* host, int32_t firstUniverse, int32_t numUniverses) {
+	close();
+	bool multicast = protocol == DMXProtocol::Sacn && (!*host || !strcmp(host, "255.255.255.255"));
+	if (protocol == DMXProtocol::Sacn && (firstUniverse < SACN_MIN_UNIVERSE || firstUniverse + numUniverses - 1 > SACN_MAX_UNIVERSE))
+		return false;
+	handle = openUDPSocket();
+	if (handle == -1)
+		return false;
+
+	sockaddr_in destination = {};
+	if (!multicast) {
+		addrinfo hints = {};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo* result = nullptr;
+		if (getaddrinfo(host, nullptr, &hints, &result) != 0 || !result) {
+			close();
+			return false;
+		}
+		memcpy(&destination, result->ai_addr, sizeof(destination));
+		freeaddrinfo(result);
+	}
+	destination.sin_family = AF_INET;
+	destination.sin_port = htons(protocol == DMXProtocol::Sacn ? SACN_PORT : ARTNET_PORT);
+	addresses.resize(static_cast<size_t>(numUniverses) * sizeof(sockaddr_in));
+	for (int32_t u = 0; u < numUniverses; u++) {
+		// A universe's multicast group is 239.255.<high byte>.<low byte>
+		if (multicast) {
+			uint32_t universe = static_cast<uint32_t>(firstUniverse + u);
+			destination.sin_addr.s_addr = htonl(0xEFFF0000u | universe);
+		}
+		memcpy(&addresses[u * sizeof(sockaddr_in)], &destination, sizeof(destination));
 	}
 
-	{
-		OP_NumericParameter np;
+	int broadcast = 1;
+	setsockopt(static_cast<SocketHandle>(handle), SOL_SOCKET, SO_BROADCAST,
+			   reinterpret_cast<const char*>(&broadcast), sizeof(broadcast));
 
-		np.name = "Maxyaw";
-		np.label = "Max Yaw";
-		np.defaultValues[0] = 45.0;
-		np.minSliders[0] = -90.0;
-		np.maxSliders[0] = 90.0;
+	// Every packet's header is written here, send() only fills in the
+	// sequence and the slots
+	if (protocol == DMXProtocol::Sacn) {
+		sequenceOffset = SACN_SEQUENCE_OFFSET;
+		slotsOffset = SACN_HEADER_SIZE;
+	}
+	else {
+		sequenceOffset = 12;
+		slotsOffset = ARTDMX_HEADER_SIZE;
+	}
+	packetSize = slotsOffset + DMX_UNIVERSE_SIZE;
+	this->numUniverses = numUniverses;
+	packets.assign(static_cast<size_t>(numUniverses) * packetSize, 0);
+
+	// sACN identifies the source by a random CID, the same for each universe
+	uint8_t cid[16];
+	std::random_device random;
+	for (int i = 0; i < 16; i++)
+		cid[i] = static_cast<uint8_t>(random());
+
+	auto put16 = [](uint8_t* p, size_t value) {
+		p[0] = static_cast<uint8_t>(value >> 8);
+		p[1] = static_cast<uint8_t>(value);
+	};
+	for (int32_t u = 0; u < numUniverses; u++) {
+		uint8_t* packet = &packets[u * packetSize];
+		int32_t universe = firstUniverse + u;
+		if (protocol == DMXProtocol::Sacn) {
+			put16(packet, 0x0010);									// Preamble size
+			memcpy(packet + 4, theSacnIdentifier, sizeof(theSacnIdentifier));
+			put16(packet + 16, 0x7000 | (packetSize - 16));			// Root layer flags and length
+			packet[21] = 0x04;										// VECTOR_ROOT_E131_DATA
+			memcpy(packet + 22, cid, sizeof(cid));
+			put16(packet + 38, 0x7000 | (packetSize - 38));			// Framing layer flags and length
+			packet[43] = 0x02;										// VECTOR_E131_DATA_PACKET
+			memcpy(packet + 44, "Kinetic Light CHOP", 18);			// Source name
+			packet[108] = 100;										// Priority
+			put16(packet + 113, static_cast<size_t>(universe & 0xffff));
+			put16(packet + 115, 0x7000 | (packetSize - 115));		// DMP layer flags and length
+			packet[117] = 0x02;										// VECTOR_DMP_SET_PROPERTY
+			packet[118] = 0xa1;										// Address and data type
+			put16(packet + 121, 1);									// Address increment
+			put16(packet + 123, DMX_UNIVERSE_SIZE + 1);				// Start code and slots
+		}
+		else {
+			memcpy(packet, "Art-Net", 8);
+			packet[9] = 0x50;										// OpCode, low byte first
+			packet[11] = 14;										// Protocol version, high byte first
+			packet[14] = static_cast<uint8_t>(universe & 0xff);		// SubUni
+			packet[15] = static_cast<uint8_t>((universe >> 8) & 0x7f);	// Net
+			put16(packet + 16, DMX_UNIVERSE_SIZE);
+		}
+	}
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
+#ifdef __linux__
+	// One message per packet, all to the same destination
+	iovecs.assign(numUniverses, iovec());
+	messages.assign(numUniverses, mmsghdr());
+	for (int32_t u = 0; u < numUniverses; u++) {
+		iovecs[u].iov_base = &packets[u * packetSize];
+		iovecs[u].iov_len = packetSize;
+		messages[u].msg_hdr.msg_name = &addresses[u * sizeof(sockaddr_in)];
+		messages[u].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		messages[u].msg_hdr.msg_iov = &iovecs[u];
+		messages[u].msg_hdr.msg_iovlen = 1;
 	}
+	batched = true;
+#endif
+	return true;
+}
 
-	// need parameters for calibation of  max Hieght that motor can goes, min Height and 0 to 255 min DMXOUT and ,ax DMXOUT
+void DMXSocket::close() {
+	if (handle == -1)
+		return;
+	closeUDPSocket(handle);
+	handle = -1;
+}
 
-	{
-		OP_NumericParameter np;
+void DMXSocket::setBatched(bool on) {
+#ifdef __linux__
+	batched = on && isOpen();
+#else
+	(void)on;
+#endif
+}
 
-		np.name = "Calibrationmaxheight";
-		np.label = "Motor Calibration Max height";
-		np.defaultValues[0] = 3.0;
-		np.minSliders[0] = 1.0;
-		np.maxSliders[0] = 10.0;
+bool DMXSocket::send(const uint8_t* universes, uint8_t sequence) {
+	if (!isOpen())
+		return false;
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
+	for (int32_t u = 0; u < numUniverses; u++) {
+		uint8_t* packet = &packets[u * packetSize];
+		packet[sequenceOffset] = sequence;
+		memcpy(packet + slotsOffset, universes + static_cast<size_t>(u) * DMX_UNIVERSE_SIZE, DMX_UNIVERSE_SIZE);
+	}
 
+	int32_t next = 0;
+#ifdef __linux__
+	// The whole frame goes to the kernel in as few calls as it takes. A
+	// kernel without sendmmsg() falls back to a call per packet for good.
+	while (batched && next < numUniverses) {
+		int sent = sendmmsg(static_cast<SocketHandle>(handle), &messages[next], numUniverses - next, 0);
+		if (sent > 0)
+			next += sent;
+		else if (sent < 0 && errno == ENOSYS)
+			batched = false;
+		else if (sent == 0 || errno != EINTR)
+			return false;
 	}
+#endif
 
-	{
-		OP_NumericParameter np;
+	bool ok = true;
+	for (int32_t u = next; u < numUniverses; u++) {
+		const uint8_t* packet = &packets[u * packetSize];
+		const sockaddr* address = reinterpret_cast<const sockaddr*>(&addresses[u * sizeof(sockaddr_in)]);
+#ifdef _WIN32
+		int sent = sendto(static_cast<SocketHandle>(handle), reinterpret_cast<const char*>(packet), static_cast<int>(packetSize), 0,
+						  address, sizeof(sockaddr_in));
+#else
+		ssize_t sent = sendto(static_cast<SocketHandle>(handle), packet, packetSize, 0, address, sizeof(sockaddr_in));
+#endif
+		ok = ok && sent == static_cast<decltype(sent)>(packetSize);
+	}
+	return ok;
+}
 
-		np.name = "Calibrationminheight";
-		np.label = "Motor Calibration Min height";
-		np.defaultValues[0] = 0.5;
-		np.minSliders[0] = 0.0;
-		np.maxSliders[0] = 1.0;
+// Label of the "Output Only Send DMX Packet" request
+const uint8_t ENTTEC_SEND_DMX_LABEL = 6;
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
+EnttecPort::EnttecPort()
+#ifdef _WIN32
+	: file(INVALID_HANDLE_VALUE),
+#else
+	: fd(-1),
+#endif
+	  message(), written(0), pending(0)
+{
+	// Everything but the slots stays the same from message to message
+	const size_t length = DMX_UNIVERSE_SIZE + 1;
+	message[0] = 0x7e;
+	message[1] = ENTTEC_SEND_DMX_LABEL;
+	message[2] = static_cast<uint8_t>(length & 0xff);
+	message[3] = static_cast<uint8_t>(length >> 8);
+	message[4] = 0;										// Start code
+	message[ENTTEC_MESSAGE_SIZE - 1] = 0xe7;
+}
 
+EnttecPort::~EnttecPort() {
+	close();
+}
+
+bool EnttecPort::open(const char* path) {
+	close();
+#ifdef _WIN32
+	// COM10 and up only open through the device namespace
+	std::wstring device = widePath(path);
+	if (device.compare(0, 4, L"\\\\.\\") != 0)
+		device = L"\\\\.\\" + device;
+	file = CreateFileW(device.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	// Serial writes on Windows can't be made non-blocking without overlapped
+	// I/O, so they time out after a millisecond with what the port took
+	COMMTIMEOUTS timeouts = {};
+	timeouts.WriteTotalTimeoutConstant = 1;
+	SetCommTimeouts(static_cast<HANDLE>(file), &timeouts);
+	DCB dcb = {};
+	dcb.DCBlength = sizeof(dcb);
+	if (GetCommState(static_cast<HANDLE>(file), &dcb)) {
+		dcb.BaudRate = CBR_57600;
+		dcb.ByteSize = 8;
+		dcb.Parity = NOPARITY;
+		dcb.StopBits = ONESTOPBIT;
+		SetCommState(static_cast<HANDLE>(file), &dcb);
+	}
+#else
+	fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0)
+		return false;
+
+	// The widget is a USB device and ignores the baud rate, but the port has
+	// to pass bytes through untouched
+	termios options;
+	if (tcgetattr(fd, &options) == 0) {
+		cfmakeraw(&options);
+		cfsetispeed(&options, B57600);
+		cfsetospeed(&options, B57600);
+		options.c_cflag |= CLOCAL | CREAD;
+		tcsetattr(fd, TCSANOW, &options);
 	}
+#endif
+	written = 0;
+	pending = 0;
+	return true;
+}
 
-	{
-		OP_NumericParameter np;
+void EnttecPort::close() {
+#ifdef _WIN32
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(static_cast<HANDLE>(file));
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+#endif
+}
 
-		np.name = "Calibrationmindmxout";
-		np.label = "Motor Calibration Min DMXOUT";
-		np.defaultValues[0] = 0.0;
-		np.minSliders[0] = 0.0;
-		np.maxSliders[0] = 255.0;
+bool EnttecPort::isOpen() const {
+#ifdef _WIN32
+	return file != INVALID_HANDLE_VALUE;
+#else
+	return fd >= 0;
+#endif
+}
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
+bool EnttecPort::send(const uint8_t* slots) {
+	if (!isOpen())
+		return false;
+	if (!pending) {
+		memcpy(message + 5, slots, DMX_UNIVERSE_SIZE);
+		written = 0;
+		pending = ENTTEC_MESSAGE_SIZE;
+	}
 
+	while (pending) {
+#ifdef _WIN32
+		DWORD count = 0;
+		if (!WriteFile(static_cast<HANDLE>(file), message + written, static_cast<DWORD>(pending), &count, nullptr))
+			return false;
+		if (count == 0)
+			return true;
+#else
+		ssize_t count = ::write(fd, message + written, pending);
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true;
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return false;
+#endif
+		written += static_cast<size_t>(count);
+		pending -= static_cast<size_t>(count);
 	}
+	return true;
+}
 
-	{
-		OP_NumericParameter np;
+DMXSender::DMXSender()
+	: protocol(DMXProtocol::ArtNet), rate(0.0), firstUniverse(0), numUniverses(0),
+	  quit(false), failed(false), jitter(0.0f), maxJitter(0.0f), sendTime(0.0f), framesSent(0) {}
 
-		np.name = "Calibrationmaxdmxout";
-		np.label = "Motor Calibration Max DMXOUT";
-		np.defaultValues[0] = 255.0;
-		np.minSliders[0] = 0.0;
-		np.maxSliders[0] = 255.0;
+DMXSender::~DMXSender() {
+	stop();
+}
 
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
+bool DMXSender::start(DMXProtocol protocol, const char* host, double rate, int32_t firstUniverse, int32_t numUniverses) {
+	stop();
+
+	this->protocol = protocol;
+	this->host = host;
+	this->rate = rate;
+	this->firstUniverse = firstUniverse;
+	this->numUniverses = numUniverses;
+	mailbox.reset();
+	for (int i = 0; i < 3; i++)
+		mailbox[i].assign(static_cast<size_t>(numUniverses) * DMX_UNIVERSE_SIZE, 0);
+	log.reset(numUniverses);
+
+	jitter = 0.0f;
+	maxJitter = 0.0f;
+	sendTime = 0.0f;
+	framesSent = 0;
+	if (protocol == DMXProtocol::Enttec)
+		failed = !serial.open(host);
+	else
+		failed = !socket.open(protocol, host, firstUniverse, numUniverses);
+	if (failed)
+		return false;
+
+	quit = false;
+	thread = std::thread(&DMXSender::senderLoop, this);
+	return true;
+}
 
+void DMXSender::stop() {
+	{
+		// Set under the lock, so the thread can't miss it between checking
+		// quit and going to sleep
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		quit = true;
 	}
+	wake.notify_one();
+	if (thread.joinable())
+		thread.join();
+	socket.close();
+	serial.close();
+	failed = false;
+}
 
+void DMXSender::publish(const uint8_t* universes) {
+	if (!isRunning())
+		return;
+	std::vector<uint8_t>& frame = mailbox.back();
+	memcpy(frame.data(), universes, frame.size());
+	mailbox.publish();
+}
 
+void DMXSender::senderLoop() {
+	using Clock = std::chrono::steady_clock;
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
 
+	// Sleeps wake up this long before the deadline, which covers the
+	// scheduler's wake-up latency, and spin the rest of the way
+	const Clock::duration spinMargin = std::chrono::microseconds(1500);
+#ifdef _WIN32
+	// Sleeps are only as fine as the system timer, 15.6 ms by default
+	timeBeginPeriod(1);
+#endif
 
+	// Jitter is averaged over a window of about a second of ticks
+	const int32_t windowTicks = std::max(static_cast<int32_t>(rate), 1);
+	double jitterSum = 0.0;
+	double jitterPeak = 0.0;
+	double sendSum = 0.0;
+	int32_t ticks = 0;
+
+	bool haveFrame = false;
+	uint8_t sequence = 0;
+	Clock::time_point deadline = Clock::now() + period;
+	Clock::time_point previous = Clock::time_point();
+	while (!quit) {
+		{
+			// stop() wakes the sleep rather than waiting out the period
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			if (wake.wait_until(lock, deadline - spinMargin, [this] { return quit.load(); }))
+				break;
+		}
+		while (Clock::now() < deadline && !quit)
+			std::this_thread::yield();
+		if (quit)
+			break;
+		Clock::time_point now = Clock::now();
+
+		// Nothing goes out until the first frame arrives, after that the
+		// newest frame is sent on every tick
+		haveFrame = mailbox.update() || haveFrame;
+		if (haveFrame) {
+			// Art-Net reserves sequence 0 for senders that don't number
+			// their packets, so its sequence runs from 1 to 255. sACN uses
+			// all of 0 to 255.
+			if (protocol == DMXProtocol::ArtNet)
+				sequence = sequence == 255 ? 1 : sequence + 1;
+			else
+				sequence = static_cast<uint8_t>(sequence + 1);
+			log.record(sequence, mailbox.front().data(), steadyNanoseconds());
+			bool ok = protocol == DMXProtocol::Enttec ? serial.send(mailbox.front().data()) : socket.send(mailbox.front().data(), sequence);
+			failed = !ok;
+			if (ok)
+				framesSent++;
+			sendSum += std::chrono::duration<double, std::micro>(Clock::now() - now).count();
+		}
 
+		if (previous != Clock::time_point()) {
+			double error = std::abs(std::chrono::duration<double, std::micro>(now - previous - period).count());
+			jitterSum += error;
+			jitterPeak = std::max(jitterPeak, error);
+			if (++ticks == windowTicks) {
+				jitter = static_cast<float>(jitterSum / ticks);
+				maxJitter = static_cast<float>(jitterPeak);
+				sendTime = static_cast<float>(sendSum / ticks);
+				jitterSum = 0.0;
+				jitterPeak = 0.0;
+				sendSum = 0.0;
+				ticks = 0;
+			}
+		}
+		previous = now;
 
+		// Deadlines are absolute, so a late tick doesn't push back the ones
+		// after it. Ticks missed entirely are skipped rather than sent in a burst.
+		deadline += period;
+		while (deadline <= now)
+			deadline += period;
+	}
 
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
 }
 
-void 
-CPlusPlusCHOPExample::pulsePressed(const char* name, void* reserved1)
-{
-	if (!strcmp(name, "Reset"))
-	{
-		myOffset = 0.0;
+// Finds the universe, sequence number and slots of an Art-Net ArtDmx or
+// sACN data packet. Returns false for any other packet.
+static bool parseDMXPacket(const uint8_t* packet, size_t size, DMXProtocol& protocol, int32_t& universe,
+						   int32_t& sequence, const uint8_t*& slots, size_t& numSlots) {
+	if (size >= ARTDMX_HEADER_SIZE && memcmp(packet, "Art-Net", 8) == 0 && packet[8] == 0x00 && packet[9] == 0x50) {
+		protocol = DMXProtocol::ArtNet;
+		universe = packet[14] | ((packet[15] & 0x7f) << 8);
+		sequence = packet[12];
+		slots = packet + ARTDMX_HEADER_SIZE;
+		numSlots = std::min<size_t>((packet[16] << 8) | packet[17], size - ARTDMX_HEADER_SIZE);
+		return true;
+	}
+	if (size >= SACN_HEADER_SIZE && memcmp(packet + 4, theSacnIdentifier, sizeof(theSacnIdentifier)) == 0 &&
+		packet[21] == 0x04 && packet[43] == 0x02 && packet[125] == 0) {
+		protocol = DMXProtocol::Sacn;
+		universe = (packet[113] << 8) | packet[114];
+		sequence = packet[SACN_SEQUENCE_OFFSET];
+		slots = packet + SACN_HEADER_SIZE;
+		numSlots = std::min<size_t>(std::max((packet[123] << 8) | packet[124], 1) - 1, size - SACN_HEADER_SIZE);
+		return true;
 	}
+	return false;
 }
 
+DMXReceiver::DMXReceiver()
+	: handle(-1), port(0), log(nullptr), firstUniverse(0), numUniverses(0),
+	  quit(false), failed(false), packetsReceived(0), packetsLost(0), mismatches(0), latency(0.0f), maxLatency(0.0f) {}
 
-// Motor base class constructor
-Motor::Motor(MotorType t) : type(t) {}
-
-// Clamp DMX values to the 0-255 range
-int Motor::clamp(int value) { return (value < 0) ? 0 : (value > 255) ? 255 : value; }
-
-// Set a specific DMX channel's value
-void Motor::setChannel(int channel, uint8_t value) {
-	dmxChannels[channel] = clamp(value);
+DMXReceiver::~DMXReceiver() {
+	stop();
 }
 
-// Get a specific DMX channel's value
-int Motor::getChannel(int channel) const {
-	auto it = dmxChannels.find(channel);
-	return (it != dmxChannels.end()) ? it->second : 0;
+bool DMXReceiver::start(uint16_t port, const SendLog* log, int32_t firstUniverse, int32_t numUniverses) {
+	stop();
+
+	this->port = port;
+	this->log = log;
+	this->firstUniverse = firstUniverse;
+	this->numUniverses = numUniverses;
+	lastSequence.assign(numUniverses, -1);
+	packetsReceived = 0;
+	packetsLost = 0;
+	mismatches = 0;
+	latency = 0.0f;
+	maxLatency = 0.0f;
+
+	handle = openUDPSocket();
+	failed = handle == -1;
+	if (failed)
+		return false;
+
+	// Other Art-Net software on this machine may be listening too
+	int reuse = 1;
+	setsockopt(static_cast<SocketHandle>(handle), SOL_SOCKET, SO_REUSEADDR,
+			   reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+	// stop() wakes a blocked receive, the timeout is a fallback for
+	// systems that don't wake it on shutdown()
+#ifdef _WIN32
+	DWORD timeout = 100;
+#else
+	timeval timeout = { 0, 100000 };
+#endif
+	setsockopt(static_cast<SocketHandle>(handle), SOL_SOCKET, SO_RCVTIMEO,
+			   reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+	sockaddr_in local = {};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(port);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(static_cast<SocketHandle>(handle), reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+		closeUDPSocket(handle);
+		handle = -1;
+		failed = true;
+		return false;
+	}
+
+	quit = false;
+	thread = std::thread(&DMXReceiver::receiverLoop, this);
+	return true;
 }
 
-// Print all DMX channel values for the motor
-void Motor::printStatus() const {
-	std::cout << (type == NINE_CH ? "9CH" : type == TEN_CH ? "10CH" : "62CH") << " Motor - ";
-	for (const auto& channel : dmxChannels) {
-		std::cout << "CH" << channel.first << ": " << channel.second << " ";
+void DMXReceiver::stop() {
+	quit = true;
+	if (thread.joinable()) {
+		if (wakeUDPSocket(handle))
+			handle = -1;
+		thread.join();
 	}
-	std::cout << std::endl;
+	if (handle != -1)
+		closeUDPSocket(handle);
+	handle = -1;
+	failed = false;
 }
 
-// 9CH Motor constructor initializes channels
-Motor9CH::Motor9CH() : Motor(NINE_CH) {
-	for (int ch = 1; ch <= 9; ++ch) dmxChannels[ch] = 0;
-}
+void DMXReceiver::receiverLoop() {
+	// Latency is averaged over windows of a second
+	const int64_t window = 1000000000;
+	int64_t windowStart = steadyNanoseconds();
+	double latencySum = 0.0;
+	double latencyPeak = 0.0;
+	int64_t latencyCount = 0;
+
+	// stop() may reset the member once it has closed the socket
+	SocketHandle socket = static_cast<SocketHandle>(handle);
+	uint8_t packet[1500];
+	uint8_t universeSlots[DMX_UNIVERSE_SIZE];
+	while (!quit) {
+#ifdef _WIN32
+		int size = recv(socket, reinterpret_cast<char*>(packet), sizeof(packet), 0);
+#else
+		ssize_t size = recv(socket, packet, sizeof(packet), 0);
+#endif
+		int64_t now = steadyNanoseconds();
+
+		DMXProtocol protocol;
+		int32_t universe, sequence;
+		const uint8_t* slots;
+		size_t numSlots;
+		if (size > 0 && parseDMXPacket(packet, static_cast<size_t>(size), protocol, universe, sequence, slots, numSlots)) {
+			packetsReceived++;
+			int32_t index = universe - firstUniverse;
+			if (index >= 0 && index < numUniverses) {
+				// Art-Net numbers packets from 1 to 255, and 0 means unnumbered.
+				// sACN numbers them from 0 to 255. Packets that aren't ahead of
+				// the last one arrived late and are left out of the loss count.
+				int32_t span = protocol == DMXProtocol::ArtNet ? 255 : 256;
+				int32_t& last = lastSequence[index];
+				if (protocol == DMXProtocol::ArtNet && sequence == 0)
+					last = -1;
+				else if (last < 0)
+					last = sequence;
+				else {
+					int32_t ahead = ((sequence - last) % span + span) % span;
+					if (ahead > 0 && ahead < span / 2) {
+						packetsLost += ahead - 1;
+						last = sequence;
+					}
+				}
+
+				int64_t sentTime;
+				uint32_t sentHash;
+				if (log && log->lookup(static_cast<uint8_t>(sequence), index, sentTime, sentHash)) {
+					// Short packets leave the rest of the universe at 0
+					memcpy(universeSlots, slots, std::min<size_t>(numSlots, DMX_UNIVERSE_SIZE));
+					memset(universeSlots + std::min<size_t>(numSlots, DMX_UNIVERSE_SIZE), 0,
+						   DMX_UNIVERSE_SIZE - std::min<size_t>(numSlots, DMX_UNIVERSE_SIZE));
+					if (hashSlots(universeSlots, DMX_UNIVERSE_SIZE) != sentHash)
+						mismatches++;
+
+					double micros = (now - sentTime) / 1000.0;
+					latencySum += micros;
+					latencyPeak = std::max(latencyPeak, micros);
+					latencyCount++;
+				}
+			}
+		}
 
-void Motor9CH::printStatus() const {
-	std::cout << "9CH Motor - ";
-	Motor::printStatus();
+		if (now - windowStart >= window) {
+			latency = latencyCount ? static_cast<float>(latencySum / latencyCount) : 0.0f;
+			maxLatency = static_cast<float>(latencyPeak);
+			latencySum = 0.0;
+			latencyPeak = 0.0;
+			latencyCount = 0;
+			windowStart = now;
+		}
+	}
 }
 
-// 10CH Motor constructor initializes channels
-Motor10CH::Motor10CH() : Motor(TEN_CH) {
-	for (int ch = 1; ch <= 10; ++ch) dmxChannels[ch] = 0;
-}
+FeedbackReceiver::FeedbackReceiver()
+	: handle(-1), port(0), numMotors(0), quit(false), failed(false), reports(0) {}
 
-void Motor10CH::printStatus() const {
-	std::cout << "10CH Motor - ";
-	Motor::printStatus();
+FeedbackReceiver::~FeedbackReceiver() {
+	stop();
 }
 
-// 62CH Motor constructor initializes channels
-Motor62CH::Motor62CH() : Motor(SIXTY_TWO_CH) {
-	for (int ch = 1; ch <= 62; ++ch) dmxChannels[ch] = 0;
-}
+bool FeedbackReceiver::start(uint16_t port, size_t numFixtures) {
+	stop();
 
-void Motor62CH::printStatus() const {
-	std::cout << "62CH Motor - ";
-	Motor::printStatus();
-}
+	this->port = port;
+	numMotors = numFixtures * 3;
+	heights.reset(new std::atomic<float>[numMotors]);
+	times.reset(new std::atomic<int64_t>[numMotors]);
+	for (size_t i = 0; i < numMotors; i++) {
+		heights[i] = 0.0f;
+		times[i] = 0;
+	}
+	reports = 0;
 
+	handle = openUDPSocket();
+	failed = handle == -1;
+	if (failed)
+		return false;
 
-KineticLight::KineticLight(Motor* m1, Motor* m2, Motor* m3)
-	: motor1(m1), motor2(m2), motor3(m3) {}
+	// stop() wakes a blocked receive, the timeout is a fallback for
+	// systems that don't wake it on shutdown()
+#ifdef _WIN32
+	DWORD timeout = 100;
+#else
+	timeval timeout = { 0, 100000 };
+#endif
+	setsockopt(static_cast<SocketHandle>(handle), SOL_SOCKET, SO_RCVTIMEO,
+			   reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+	sockaddr_in local = {};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(port);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(static_cast<SocketHandle>(handle), reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+		closeUDPSocket(handle);
+		handle = -1;
+		failed = true;
+		return false;
+	}
 
-KineticLight::~KineticLight() {
-	delete motor1;
-	delete motor2;
-	delete motor3;
+	quit = false;
+	thread = std::thread(&FeedbackReceiver::receiverLoop, this);
+	return true;
 }
 
-void KineticLight::setMotorChannel(int motorIndex, int channel, uint8_t value) {
-	if (motorIndex == 1) motor1->setChannel(channel, value);
-	else if (motorIndex == 2) motor2->setChannel(channel, value);
-	else if (motorIndex == 3) motor3->setChannel(channel, value);
+void FeedbackReceiver::stop() {
+	quit = true;
+	if (thread.joinable()) {
+		if (wakeUDPSocket(handle))
+			handle = -1;
+		thread.join();
+	}
+	if (handle != -1)
+		closeUDPSocket(handle);
+	handle = -1;
+	failed = false;
 }
 
-void KineticLight::printStatus() const {
-	std::cout << "Kinetic Light Status:" << std::endl;
-	motor1->printStatus();
-	motor2->printStatus();
-	motor3->printStatus();
+size_t FeedbackReceiver::read(float* heights, float* fresh, int64_t* times, size_t count, float timeout) const {
+	int64_t oldest = steadyNanoseconds() - static_cast<int64_t>(std::max(timeout, 0.0f) * 1e9);
+	size_t numFresh = 0;
+	size_t i = 0;
+	if (this->heights) {
+		for (; i < count && i < numMotors; i++) {
+			// The time is stored after the height, so a fresh time has its height
+			int64_t time = this->times[i].load(std::memory_order_acquire);
+			heights[i] = this->heights[i].load(std::memory_order_relaxed);
+			times[i] = time;
+			bool isFresh = time != 0 && time >= oldest;
+			fresh[i] = isFresh ? 1.0f : 0.0f;
+			numFresh += isFresh;
+		}
+	}
+	for (; i < count; i++) {
+		heights[i] = 0.0f;
+		fresh[i] = 0.0f;
+		times[i] = 0;
+	}
+	return numFresh;
 }
 
-const Motor* KineticLight::getMotor(int index) const {
-	switch (index) {
-	case 1: return motor1;
-	case 2: return motor2;
-	case 3: return motor3;
-	default: return nullptr;
+void FeedbackReceiver::receiverLoop() {
+	// stop() may reset the member once it has closed the socket
+	SocketHandle socket = static_cast<SocketHandle>(handle);
+	char packet[1501];
+	while (!quit) {
+#ifdef _WIN32
+		int size = recv(socket, packet, sizeof(packet) - 1, 0);
+#else
+		ssize_t size = recv(socket, packet, sizeof(packet) - 1, 0);
+#endif
+		if (size <= 0)
+			continue;
+		packet[size] = '\0';
+		int64_t now = steadyNanoseconds();
+
+		// "<fixture> <motor> <height>" per line. Anything else ends the packet.
+		const char* p = packet;
+		for (;;) {
+			char* end;
+			long fixture = strtol(p, &end, 10);
+			if (end == p)
+				break;
+			p = end;
+			long motor = strtol(p, &end, 10);
+			if (end == p)
+				break;
+			p = end;
+			float height = strtof(p, &end);
+			if (end == p)
+				break;
+			p = end;
+
+			if (fixture >= 1 && motor >= 1 && motor <= 3 && static_cast<size_t>(fixture) <= numMotors / 3 && std::isfinite(height)) {
+				size_t index = static_cast<size_t>(fixture - 1) * 3 + static_cast<size_t>(motor - 1);
+				heights[index].store(height, std::memory_order_relaxed);
+				times[index].store(now, std::memory_order_release);
+				reports++;
+			}
+		}
 	}
-}
\ No newline at end of file
+}
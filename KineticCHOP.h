@@ -13,8 +13,20 @@
 */
 
 #include "CHOP_CPlusPlusBase.h"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
 
 
 using namespace TD;
@@ -40,12 +52,17 @@ public:
 
 protected:
 	MotorType type;
-	std::map<int, int> dmxChannels; // Maps channel number to value (0-255)
+	uint8_t* dmxChannels; // Channel values (0-255), indexed by channel number - 1
+	int numChannels;
 
 public:
-	Motor(MotorType t);
+	// 'channels' is storage for channelCount(t) values, owned by the caller
+	Motor(MotorType t, uint8_t* channels);
 	virtual ~Motor() = default;
 
+	// Number of DMX channels used by a motor type
+	static int channelCount(MotorType t);
+
 	// Set a specific DMX channel's value, clamped to 0-255
 	void setChannel(int channel, uint8_t value);
 
@@ -62,19 +79,19 @@ protected:
 // Derived classes for each motor type
 class Motor9CH : public Motor {
 public:
-	Motor9CH();
+	Motor9CH(uint8_t* channels);
 	void printStatus() const override;
 };
 
 class Motor10CH : public Motor {
 public:
-	Motor10CH();
+	Motor10CH(uint8_t* channels);
 	void printStatus() const override;
 };
 
 class Motor62CH : public Motor {
 public:
-	Motor62CH();
+	Motor62CH(uint8_t* channels);
 	void printStatus() const override;
 };
 
@@ -85,14 +102,879 @@ private:
 	Motor* motor1;
 	Motor* motor2;
 	Motor* motor3;
+	uint8_t* slots;
 
 public:
-	KineticLight(Motor* m1, Motor* m2, Motor* m3);
-	~KineticLight();
+	// A fixture occupies 80 consecutive DMX slots: 1-62 belong to the first
+	// motor (62CH), 63-71 to the second (9CH) and 72-80 to the third (9CH).
+	static const int NUM_SLOTS = 80;
+
+	// The motors' channel storage must be the 80 contiguous slots starting
+	// at 's'. The motors aren't owned by the KineticLight.
+	KineticLight(Motor* m1, Motor* m2, Motor* m3, uint8_t* s);
 
 	void setMotorChannel(int motorIndex, int channel, uint8_t value);
 	void printStatus() const;
 	const Motor* getMotor(int index) const;
+
+	// Fixture-relative slot access (1-80)
+	void setSlot(int slot, uint8_t value);
+	int getSlot(int slot) const;
+	const uint8_t* getSlots() const { return slots; }
+
+	// True for the height, fine-tuning and speed slots of each motor, which
+	// are written by the kinematics and can't be driven from the DMX input
+	static bool isMotionSlot(int slot);
+
+	// Slot of a motor's (1-3) height channel, its fine-tuning channel follows
+	static int motorSlot(int motorIndex);
+};
+
+// Owns every fixture of the node: the KineticLight objects, their motors
+// and the motors' DMX channel values, each in one contiguous block laid out
+// in fixture order. Fixture i uses motors 3i..3i+2 and slots 80i..80i+79,
+// so walking the fixtures by index walks memory front to back. reset()
+// rebuilds the whole rig in one go when the patch reloads.
+class FixtureArena {
+public:
+	FixtureArena();
+	~FixtureArena();
+
+	void reset(size_t numFixtures);
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	KineticLight* operator[](size_t index) const { return lights + index; }
+
+	// All fixtures' slots back to back, size() * KineticLight::NUM_SLOTS
+	const uint8_t* getSlots() const { return slots.get(); }
+	uint8_t* getSlots() { return slots.get(); }
+
+private:
+	void destroy();
+
+	std::unique_ptr<unsigned char[]> objects;
+	std::unique_ptr<uint8_t[]> slots;
+	KineticLight* lights;
+	unsigned char* motorStorage;
+	size_t count;
+	size_t capacity;
+};
+
+// Number of heap allocations made on the calling thread. Builds defining
+// KINETIC_ALLOC_AUDIT leave this to the executable, which counts them by
+// replacing the global operator new; tests/AllocationTest.cpp does. Those
+// builds can't be loaded by TouchDesigner. Always 0 otherwise.
+uint64_t threadAllocationCount();
+
+// Bump allocator for per-cook scratch memory. The block is sized outside
+// of execute() when the layout changes and reset at the start of every
+// cook. A request that doesn't fit returns nullptr, and the shortfall is
+// added the next time reserve() is called.
+class FrameArena {
+public:
+	FrameArena();
+
+	void reserve(size_t bytes);
+	bool fits(size_t bytes) const { return shortfall == 0 && bytes <= capacity; }
+	void reset() { used = 0; }
+
+	template <typename T>
+	T* alloc(size_t count) { return static_cast<T*>(allocBytes(count * sizeof(T), alignof(T))); }
+
+	size_t getCapacity() const { return capacity; }
+	size_t getHighWater() const { return highWater; }
+
+private:
+	void* allocBytes(size_t bytes, size_t alignment);
+
+	std::unique_ptr<unsigned char[]> block;
+	size_t capacity;
+	size_t used;
+	size_t highWater;
+	// Written by whichever thread computes frames, read by the cook
+	std::atomic<size_t> shortfall;
+};
+
+// Lock-free single producer / single consumer triple buffer. The producer
+// fills back() and publishes it, the consumer calls update() to move front()
+// to the newest published value. Neither side waits on the other; values
+// published faster than they're consumed are dropped.
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() : middle(1), backIndex(0), frontIndex(2) {}
+
+	// Producer side
+	T& back() { return buffers[backIndex]; }
+	void publish() { backIndex = middle.exchange(backIndex | FRESH) & INDEX_MASK; }
+
+	// Consumer side, returns false if nothing new was published
+	bool update() {
+		if (!(middle.load() & FRESH))
+			return false;
+		frontIndex = middle.exchange(frontIndex) & INDEX_MASK;
+		return true;
+	}
+	const T& front() const { return buffers[frontIndex]; }
+
+	// Direct access to all three values, only while neither side is active
+	T& operator[](int index) { return buffers[index]; }
+	void reset() { middle = 1; backIndex = 0; frontIndex = 2; }
+
+private:
+	static const int FRESH = 4;
+	static const int INDEX_MASK = 3;
+
+	T buffers[3];
+	std::atomic<int> middle;
+	int backIndex;
+	int frontIndex;
+};
+
+// Pose channels, in the order they're stored in FrameInputs::poseSamples.
+// Poses taken from a SOP hold a plane normal in place of roll, pitch and yaw.
+enum PoseChannel {
+	POSE_HEIGHT,
+	POSE_ROLL, POSE_PITCH, POSE_YAW,
+	NUM_POSE_CHANNELS,
+	POSE_NORMAL_X = POSE_ROLL, POSE_NORMAL_Y = POSE_PITCH, POSE_NORMAL_Z = POSE_YAW
+};
+
+// Most input samples kept from one cook's timeslice. Longer timeslices keep
+// the newest samples.
+const int MAX_POSE_SAMPLES = 256;
+
+// Most output samples computed in one cook when resampling. Longer output
+// timeslices hold the oldest computed sample.
+const int MAX_OUTPUT_SAMPLES = 16;
+
+enum class ResampleFilter { Linear, Cubic };
+
+struct ResampleParams {
+	bool enabled;
+	float rate;				// Output sample rate in Hz
+	ResampleFilter filter;
+	bool antiAlias;			// Widens the filter when the output rate is below the pose rate
+};
+
+enum class PredictMode { Off, Velocity, Acceleration, Kalman };
+
+// Extrapolates pose channels ahead by a lead time, to make up for the
+// motors' mechanical delay. The state of every channel lives in SoA arrays
+// updated once per input sample, so the cost is O(1) per sample per channel
+// and the inner loops run straight across channels.
+class PosePredictor {
+public:
+	PosePredictor();
+
+	// Resizing or changing mode restarts the estimates from the next sample
+	void resize(size_t channels);
+
+	// 'samples' holds numSamples rows of one value per channel, oldest first.
+	// Writes each channel's value 'lead' seconds past the newest sample to 'out'.
+	void process(const float* samples, int numSamples, float dt, float lead, PredictMode mode,
+				 float processNoise, float measurementNoise, float* out);
+
+private:
+	size_t numChannels;
+	uint64_t samplesSeen;
+	PredictMode lastMode;
+
+	std::vector<float> value;
+	std::vector<float> velocity;
+	std::vector<float> acceleration;
+
+	// Kalman covariance of (value, velocity)
+	std::vector<float> p00, p01, p11;
+};
+
+enum class SmoothMode { Off, OneEuro, Spring, Biquad };
+
+struct SmoothingParams {
+	SmoothMode mode;
+	float minCutoff, beta, derivativeCutoff;	// One-euro, cutoffs in Hz
+	float springTime;							// Critically damped spring, seconds
+	float cutoff, q;							// Biquad low-pass, cutoff in Hz
+};
+
+// Smooths pose channels sample by sample, standing in for the Filter or Lag
+// CHOPs otherwise placed in front of every input. Filter state persists
+// across cooks in SoA arrays, one entry per channel.
+class PoseSmoother {
+public:
+	PoseSmoother();
+
+	// Resizing or changing mode restarts the filters from the next sample
+	void resize(size_t channels);
+
+	// Filters numSamples rows of one value per channel, oldest first, from
+	// 'samples' into 'out'
+	void process(const float* samples, int numSamples, float dt, const SmoothingParams& params, float* out);
+
+private:
+	size_t numChannels;
+	bool primed;
+	SmoothMode lastMode;
+
+	// One-euro filtered value and derivative
+	std::vector<float> euroValue, euroDerivative;
+	// Spring position and velocity
+	std::vector<float> springValue, springVelocity;
+	// Biquad delay line, transposed direct form II
+	std::vector<float> biquadZ1, biquadZ2;
+};
+
+struct SafetyLimits {
+	bool enabled;
+	float minHeight, maxHeight;	// Absolute motor heights
+	float softKnee;				// Distance inside the limits where motors start to slow down
+	float maxSpread;			// Largest height difference between a fixture's motors
+	float maxSpeed;				// Fastest a motor may move, per second
+};
+
+// Bits of a fixture's limit hits, set when the safety envelope changed it
+enum SafetyLimitBits {
+	LIMIT_HEIGHT = 1,
+	LIMIT_SPREAD = 2,
+	LIMIT_SPEED = 4
+};
+
+// Keeps motor heights inside the rig's mechanical limits: absolute height,
+// spread between a fixture's motors and speed. Each motor's last output
+// persists across cooks for the speed limit.
+class SafetyEnvelope {
+public:
+	// Fixtures kept by a resize keep their last heights, so the speed limit
+	// holds across layout changes. Added fixtures are unlimited for a frame.
+	void resize(size_t fixtures);
+
+	// Limits 3 absolute motor heights per fixture in place. 'elapsed' is the
+	// time since the last frame. ORs each fixture's SafetyLimitBits into 'hits'.
+	void process(float* heights, size_t count, float elapsed, const SafetyLimits& limits, uint8_t* hits);
+
+private:
+	std::vector<float> last;
+	std::vector<uint8_t> primed;
+};
+
+// Closed loop correction of the motor targets from the heights the motors
+// report. Gains act on the error between a motor's target and its reported
+// absolute height, in height units and seconds.
+struct FeedbackParams {
+	bool enabled;
+	float kp, ki, kd;
+	float maxCorrection;	// Largest height added to or taken from a target
+	float timeout;			// Seconds after which a motor's report is ignored
+};
+
+// PID correction of absolute motor heights. Every motor of the rig is one
+// lane of flat arrays, without branches, so the loops vectorize across
+// fixtures. Each motor's integral and last error persist across cooks.
+class FeedbackCorrector {
+public:
+	// Resizing restarts every motor's integral from 0
+	void resize(size_t motors);
+
+	// Adds each motor's correction to its target height in place. Motors
+	// whose 'fresh' is 0 have no report to correct from, and only keep
+	// their integral and last error. A report is told apart from the one
+	// before it by its time, and only integrated and differentiated once.
+	// The derivative term waits for two fresh reports in a row. Returns
+	// the mean absolute error of the fresh motors.
+	float process(float* heights, const float* measured, const float* fresh, const int64_t* times, size_t count,
+				  float elapsed, const FeedbackParams& params);
+
+private:
+	std::vector<float> integral;
+	std::vector<float> lastError;
+	std::vector<float> lastFresh;
+	std::vector<int64_t> lastTime;
+	std::vector<float> interval;	// Seconds since the motor's last report was integrated
+};
+
+// Base geometry, limits and calibration turning poses into motor DMX values.
+// Shared by the cook and the Python batch API.
+struct MotorMapping {
+	double baseSize, minHeight, maxHeight;
+	double calMinHeight, calMaxHeight, calMinDMX, calMaxDMX;
+};
+
+// Everything a frame is computed from, copied out of the TD inputs during
+// the cook so the frame can also be computed on the async worker
+struct FrameInputs {
+	uint64_t frame;
+	float elapsed;		// Seconds since the previous frame
+	MotorMapping mapping;
+	double speed;
+
+	// This cook's pose timeslice, numPoseSamples rows oldest first, sampled
+	// at poseSampleRate. Each row holds every fixture's height, then every
+	// fixture's roll, pitch and yaw.
+	std::vector<float> poseSamples;
+	int32_t numPoseSamples;
+	float poseSampleRate;
+	bool planePose;
+
+	// Cue output, used in place of the pose when cuePose is set. Three motor
+	// values per fixture in 16 bit DMX (the 8 bit value times 256), and
+	// whether each fixture is in range. cueFine sends the low byte to the
+	// motors' fine-tuning channels.
+	bool cuePose;
+	bool cueFine;
+	std::vector<uint16_t> cueMotors;
+	std::vector<uint8_t> cueValid;
+
+	SmoothingParams smoothing;
+	PredictMode predictMode;
+	float predictLead;
+	float kalmanProcessNoise;
+	float kalmanMeasurementNoise;
+
+	// Collision avoidance between neighbouring fixtures
+	bool avoidCollisions;
+	float fixtureRadius;
+	float clearance;
+	int32_t collisionIterations;
+
+	SafetyLimits safety;
+
+	// Reported motor heights, 3 per fixture, 1 for the motors that
+	// reported within the feedback timeout and 0 for the others, and when
+	// each report arrived
+	FeedbackParams feedback;
+	std::vector<float> feedbackHeights;
+	std::vector<float> feedbackFresh;
+	std::vector<int64_t> feedbackTimes;
+
+	// Output resampling, computing numOutputSamples samples of the motor
+	// channels from the pose timeslice
+	ResampleParams resampling;
+	int32_t numOutputSamples;
+
+	// Lighting values, one per DMX route or CH4-CH62 when read positionally
+	std::vector<float> dmxValues;
+};
+
+// A computed frame: every fixture's slots, and the same slots packed into
+// the patched universes
+struct FrameOutput {
+	uint64_t frame;
+	bool valid;
+	std::vector<uint8_t> slots;
+	std::vector<uint8_t> universes;
+	std::vector<uint8_t> limitHits;
+	float feedbackError;
+	bool arenaExhausted;
+
+	// Motor values of the resampled output samples before the newest
+	std::vector<uint8_t> sampleMotors;
+	int32_t numSampleMotors;
+};
+
+// Baked show file, written by the Bake Show pulse and memory-mapped for
+// playback. A BakeHeader, the frames back to back, then numFrames
+// BakeFrameEntry. A frame holds every fixture's slots, either raw or as the
+// runs of slots changed since the previous frame: a 16 bit skip, a 16 bit
+// length and that many slot values, repeated. Every keyframeInterval-th
+// frame is raw, so any frame decodes from the keyframe before it.
+const char BAKE_MAGIC[4] = { 'K', 'D', 'M', 'X' };
+const uint32_t BAKE_VERSION = 1;
+
+struct BakeHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t numFixtures;
+	uint32_t numFrames;
+	uint32_t keyframeInterval;
+	uint32_t reserved;
+	double startIndex;		// Input sample index of the first frame
+	double sampleRate;		// Frames per second
+	uint64_t indexOffset;	// File offset of the frame index
+};
+
+struct BakeFrameEntry {
+	uint64_t offset;	// File offset of the frame data
+	uint32_t size;		// Bytes of frame data
+	uint32_t delta;		// 1 for changed runs, 0 for raw slots
+};
+
+// Encodes the slots of 'frame' that differ from 'previous' as delta runs
+// into 'out'
+void encodeBakeDelta(const uint8_t* previous, const uint8_t* frame, size_t size, std::vector<uint8_t>& out);
+
+// Applies the baked frame 'entry' of the file at 'data' to 'slots', returns
+// false if the frame is malformed
+bool applyBakeFrame(const uint8_t* data, const BakeFrameEntry& entry, uint8_t* slots, size_t numSlots);
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const char* path);
+	void close();
+
+	const uint8_t* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	const uint8_t* bytes;
+	size_t length;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+};
+
+// Writes a baked show file a frame at a time. Frames are delta encoded
+// against the previous one when 'delta' is set, and the index and header
+// are written by close().
+class BakeWriter {
+public:
+	BakeWriter();
+
+	bool open(const char* path, size_t numFixtures, uint32_t keyframeInterval, bool delta,
+			  double startIndex, double sampleRate);
+	bool write(const uint8_t* slots);
+	bool close();
+
+	uint32_t getNumFrames() const { return static_cast<uint32_t>(index.size()); }
+
+private:
+	std::ofstream file;
+	BakeHeader header;
+	bool delta;
+	uint64_t offset;
+	std::vector<BakeFrameEntry> index;
+	std::vector<uint8_t> previous;
+	std::vector<uint8_t> encoded;
+};
+
+// Lock-free single producer / single consumer ring of fixed size frames,
+// each with a number the producer gives it. reset() allocates it, only
+// while neither side is active.
+class FrameRing {
+public:
+	FrameRing();
+
+	void reset(size_t frameBytes, size_t numFrames);
+
+	// Producer side, returns false if the ring is full
+	bool push(const uint8_t* frame, uint64_t number);
+
+	// Consumer side, front() is nullptr if the ring is empty
+	const uint8_t* front(uint64_t* number) const;
+	void pop();
+
+private:
+	std::unique_ptr<uint8_t[]> storage;
+	std::unique_ptr<uint64_t[]> numbers;
+	size_t frameBytes;
+	size_t capacity;
+	std::atomic<uint64_t> head;
+	std::atomic<uint64_t> tail;
+};
+
+// Records computed frames to a baked show file without the cook touching
+// the file system. The cook copies each frame into a preallocated ring and
+// a writer thread opens the file, encodes the frames and writes them out.
+// A frame dropped because the ring was full is written as a repeat of the
+// one before it, so the file keeps a frame per push.
+class FrameRecorder {
+public:
+	FrameRecorder();
+	~FrameRecorder();
+
+	// Starts a recording once the previous one has finished writing, and
+	// returns false until then. The first frame pushed is sample startIndex
+	// at sampleRate.
+	bool start(const char* path, size_t numFixtures, size_t ringFrames, uint32_t keyframeInterval,
+			   bool delta, double startIndex, double sampleRate);
+
+	// Asks the writer to write the frames left in the ring and finish the
+	// file, without waiting for it
+	void stop();
+
+	// Cook side. Copies a frame of slots, or a frame of zeros if 'slots' is
+	// nullptr, into the ring. A full ring drops the frame.
+	void push(const uint8_t* slots);
+
+	bool isRecording() const { return recording; }
+	bool isWriting() const { return writer.joinable() && !finished; }
+	bool hasFailed() const { return failed; }
+	const std::string& getPath() const { return path; }
+	size_t getNumFixtures() const { return numFixtures; }
+	uint64_t getFramesWritten() const { return framesWritten; }
+	uint64_t getFramesDropped() const { return framesDropped; }
+
+private:
+	void writerLoop();
+
+	FrameRing ring;
+	std::vector<uint8_t> zeros;
+	std::string path;
+	size_t numFixtures;
+	uint32_t keyframeInterval;
+	bool delta;
+	double startIndex;
+	double sampleRate;
+	bool recording;
+
+	std::thread writer;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	std::atomic<bool> quit;
+	std::atomic<bool> finished;
+	std::atomic<bool> failed;
+	std::atomic<uint64_t> framesPushed;		// Dropped ones included
+	std::atomic<uint64_t> framesWritten;
+	std::atomic<uint64_t> framesDropped;
+};
+
+// Network DMX protocols, in the order of the Send Protocol menu
+enum class DMXProtocol {
+	ArtNet,		// Art-Net ArtDmx on UDP port 6454
+	Sacn,		// sACN (ANSI E1.31) data packets on UDP port 5568
+	Enttec		// ENTTEC DMX USB Pro messages on a serial port
+};
+
+// Universes sACN can send, the rest are reserved
+const int32_t SACN_MIN_UNIVERSE = 1;
+const int32_t SACN_MAX_UNIVERSE = 63999;
+
+// What the sender sent under each sequence number: when the frame was
+// handed to the socket and a hash of each of its universes, so a loopback
+// receiver can check what arrived. Written by the sender's thread and read
+// by the receiver's, entry by entry.
+class SendLog {
+public:
+	SendLog();
+
+	// Only while neither thread is running
+	void reset(int32_t numUniverses);
+
+	void record(uint8_t sequence, const uint8_t* universes, int64_t time);
+
+	// Returns false if nothing was sent under 'sequence'
+	bool lookup(uint8_t sequence, int32_t universe, int64_t& time, uint32_t& hash) const;
+
+	int32_t getNumUniverses() const { return numUniverses; }
+
+private:
+	std::unique_ptr<std::atomic<int64_t>[]> times;
+	std::unique_ptr<std::atomic<uint32_t>[]> hashes;
+	int32_t numUniverses;
+};
+
+// UDP socket sending DMX universes as Art-Net or sACN packets. The packets
+// of a whole frame live in one block allocated by open(); on Linux send()
+// hands them all to the kernel with one sendmmsg() call instead of a call
+// per packet.
+class DMXSocket {
+public:
+	DMXSocket();
+	~DMXSocket();
+
+	// Opens a socket sending numUniverses universes, the first numbered
+	// firstUniverse, to 'host', a name or IPv4 address, on the protocol's
+	// port. Broadcast addresses are allowed. sACN with an empty 'host' or
+	// 255.255.255.255 goes to each universe's multicast group instead, and
+	// needs its universes within 1 to 63999.
+	bool open(DMXProtocol protocol, const char* host, int32_t firstUniverse, int32_t numUniverses);
+	void close();
+	bool isOpen() const { return handle != -1; }
+
+	// Sends a frame of numUniverses * 512 slots. Returns false if any
+	// packet failed to send.
+	bool send(const uint8_t* universes, uint8_t sequence);
+
+	// Sends a call per packet instead of batching a frame into sendmmsg()
+	// calls, to compare the two. Batching is only available on Linux and
+	// is on by default after open().
+	void setBatched(bool on);
+
+private:
+	intptr_t handle;			// SOCKET on Windows, a file descriptor elsewhere
+	std::vector<uint8_t> addresses;	// sockaddr_in of each universe's destination
+	int32_t numUniverses;
+	size_t packetSize;
+	size_t sequenceOffset;
+	size_t slotsOffset;
+	std::vector<uint8_t> packets;
+	bool batched;
+#ifdef __linux__
+	std::vector<iovec> iovecs;
+	std::vector<mmsghdr> messages;
+#endif
+};
+
+// Size of an ENTTEC DMX USB Pro "Output Only Send DMX Packet" message: start
+// delimiter, label, data length, start code, 512 slots and end delimiter
+const size_t ENTTEC_MESSAGE_SIZE = 518;
+
+// Serial port sending one universe as ENTTEC DMX USB Pro messages. Writes
+// never block: a message the port can't take whole is finished by later
+// calls, and universes passed in meanwhile are dropped.
+class EnttecPort {
+public:
+	EnttecPort();
+	~EnttecPort();
+
+	// Opens a serial device, like COM3 or /dev/ttyUSB0
+	bool open(const char* path);
+	void close();
+	bool isOpen() const;
+
+	// Starts a message with the universe's 512 slots if the previous one
+	// has been written, then writes as much as the port takes. Returns
+	// false on a write error.
+	bool send(const uint8_t* slots);
+
+	// Bytes of the current message still to be written
+	size_t getPending() const { return pending; }
+
+private:
+#ifdef _WIN32
+	void* file;
+#else
+	int fd;
+#endif
+	uint8_t message[ENTTEC_MESSAGE_SIZE];
+	size_t written;
+	size_t pending;
+};
+
+// Sends DMX frames at a fixed rate from its own thread, so packets go out
+// evenly spaced however the cooks fall. The cook publishes each frame into
+// a lock-free mailbox and the thread sends the newest one on every tick,
+// repeating the last frame if no new one arrived. Each tick sleeps until
+// shortly before its absolute deadline and spins the rest of the way.
+class DMXSender {
+public:
+	DMXSender();
+	~DMXSender();
+
+	// Starts sending numUniverses universes to 'host' at 'rate' Hz,
+	// stopping first if already running. For ENTTEC 'host' is the serial
+	// device, and only the first universe is sent.
+	bool start(DMXProtocol protocol, const char* host, double rate, int32_t firstUniverse, int32_t numUniverses);
+	void stop();
+
+	// Cook side. Copies a frame of universes into the mailbox. Until the
+	// next one the thread keeps sending this one.
+	void publish(const uint8_t* universes);
+
+	bool isRunning() const { return thread.joinable(); }
+	bool hasFailed() const { return failed; }
+	DMXProtocol getProtocol() const { return protocol; }
+	const std::string& getHost() const { return host; }
+	double getRate() const { return rate; }
+	int32_t getFirstUniverse() const { return firstUniverse; }
+	int32_t getNumUniverses() const { return numUniverses; }
+
+	// Every frame sent since start(). Kept after stop(), and only reset by
+	// the next start().
+	const SendLog& getLog() const { return log; }
+
+	// Timing over roughly the last second, in microseconds: the mean and
+	// largest difference between a tick's interval and the period, and the
+	// mean time a tick spends handing its frame to the socket
+	float getJitter() const { return jitter; }
+	float getMaxJitter() const { return maxJitter; }
+	float getSendTime() const { return sendTime; }
+	uint64_t getFramesSent() const { return framesSent; }
+
+private:
+	void senderLoop();
+
+	DMXSocket socket;
+	EnttecPort serial;
+	SendLog log;
+	TripleBuffer<std::vector<uint8_t>> mailbox;
+	DMXProtocol protocol;
+	std::string host;
+	double rate;
+	int32_t firstUniverse;
+	int32_t numUniverses;
+
+	std::thread thread;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	std::atomic<bool> quit;
+	std::atomic<bool> failed;
+	std::atomic<float> jitter;
+	std::atomic<float> maxJitter;
+	std::atomic<float> sendTime;
+	std::atomic<uint64_t> framesSent;
+};
+
+// Listens for Art-Net and sACN on its own thread, to see what the fixtures
+// receive. Packets for the numUniverses universes from firstUniverse are
+// checked for gaps in their sequence numbers and, given the sender's log,
+// for latency and for slots differing from what was sent.
+class DMXReceiver {
+public:
+	DMXReceiver();
+	~DMXReceiver();
+
+	// Starts listening on 'port', stopping first if already running. 'log'
+	// may be nullptr, and has to outlive the receiver running.
+	bool start(uint16_t port, const SendLog* log, int32_t firstUniverse, int32_t numUniverses);
+	void stop();
+
+	bool isRunning() const { return thread.joinable(); }
+	bool hasFailed() const { return failed; }
+	uint16_t getPort() const { return port; }
+	const SendLog* getLog() const { return log; }
+	int32_t getFirstUniverse() const { return firstUniverse; }
+	int32_t getNumUniverses() const { return numUniverses; }
+
+	uint64_t getPacketsReceived() const { return packetsReceived; }
+	uint64_t getPacketsLost() const { return packetsLost; }
+	uint64_t getMismatches() const { return mismatches; }
+
+	// Mean and largest time from handing a frame to the socket to receiving
+	// it, over roughly the last second, in microseconds
+	float getLatency() const { return latency; }
+	float getMaxLatency() const { return maxLatency; }
+
+private:
+	void receiverLoop();
+
+	intptr_t handle;
+	uint16_t port;
+	const SendLog* log;
+	int32_t firstUniverse;
+	int32_t numUniverses;
+	std::vector<int32_t> lastSequence;	// Per universe, -1 until a packet arrives
+
+	std::thread thread;
+	std::atomic<bool> quit;
+	std::atomic<bool> failed;
+	std::atomic<uint64_t> packetsReceived;
+	std::atomic<uint64_t> packetsLost;
+	std::atomic<uint64_t> mismatches;
+	std::atomic<float> latency;
+	std::atomic<float> maxLatency;
+};
+
+// Listens for motor position reports on a UDP port on its own thread, and
+// keeps each motor's newest height in a table of atomics the cook reads
+// without locking. A report is a text line "<fixture> <motor> <height>",
+// the fixture and motor counted from 1 and the height absolute, like the
+// Min and Max Height parameters. A packet may hold any number of reports.
+class FeedbackReceiver {
+public:
+	FeedbackReceiver();
+	~FeedbackReceiver();
+
+	// Starts listening on 'port' for numFixtures fixtures' motors, stopping
+	// first if already running
+	bool start(uint16_t port, size_t numFixtures);
+	void stop();
+
+	bool isRunning() const { return thread.joinable(); }
+	bool hasFailed() const { return failed; }
+	uint16_t getPort() const { return port; }
+	size_t getNumFixtures() const { return numMotors / 3; }
+	uint64_t getReports() const { return reports; }
+
+	// Cook side. Copies the newest height of each of 'count' motors and
+	// the steady clock time it arrived at, 0 before the first, and sets
+	// 'fresh' to 1 for those that reported within 'timeout' seconds and to
+	// 0 for the others. Returns the number of fresh motors.
+	size_t read(float* heights, float* fresh, int64_t* times, size_t count, float timeout) const;
+
+private:
+	void receiverLoop();
+
+	intptr_t handle;
+	uint16_t port;
+	size_t numMotors;
+	std::unique_ptr<std::atomic<float>[]> heights;
+	std::unique_ptr<std::atomic<int64_t>[]> times;	// Steady clock nanoseconds, 0 until the first report
+
+	std::thread thread;
+	std::atomic<bool> quit;
+	std::atomic<bool> failed;
+	std::atomic<uint64_t> reports;
+};
+
+// Number of slots in a DMX universe
+const int DMX_UNIVERSE_SIZE = 512;
+
+// Where a fixture's 80 slot block sits in the DMX universes
+struct FixturePatch {
+	int32_t universe;	// Universe number as used by the DMX output
+	int32_t address;	// 1-based start address within the universe
+	float u, v;			// Where the fixture samples the Pose TOP
+	float x, z;			// Fixture center in the rig, seen from above. NaN places it on the grid.
+};
+
+// Two fixtures close enough that their plates overlap seen from above.
+// dx and dz point from a to b.
+struct CollisionPair {
+	uint32_t a, b;
+	float dx, dz;
+	float distance;
+};
+
+enum class OutputMode {
+	Channels,	// 80 channels per fixture (dmx1, dmx2, ...)
+	Universes	// Complete 512 slot universes
+};
+
+enum class UniverseLayout {
+	SlotChannels,		// One channel per universe slot, one sample
+	UniverseChannels	// One channel per universe, one sample per slot
+};
+
+enum class PoseInputMode {
+	Separate,	// Height, roll, pitch and yaw on inputs 1-4
+	Packed,		// All four on input 1
+	Sop,		// Height and plane normal from the points of the Pose SOP
+	Top,		// Height and tilt sampled from the Pose TOP
+	Cues		// Crossfades between stored cues
+};
+
+enum class CueFadeMode {
+	Motors,			// Lerps the 16 bit motor values
+	Orientation		// Slerps each fixture's orientation
+};
+
+// Cue orientations, stored in blocks of one channel for all fixtures so the
+// fade runs over whole blocks at once
+enum CueOrientationChannel {
+	ORIENT_W, ORIENT_X, ORIENT_Y, ORIENT_Z,
+	ORIENT_HEIGHT,
+	NUM_ORIENT_CHANNELS
+};
+
+// A stored pose for every fixture and the motor values it maps to. The
+// motor values are computed the first time the cue is used, and again
+// after the mapping changes.
+struct Cue {
+	std::string name;
+	std::vector<float> pose;		// Height, roll, pitch and yaw per fixture
+	std::vector<uint16_t> motors;	// 3 per fixture, 16 bit DMX
+	std::vector<uint8_t> valid;		// Per fixture
+	std::vector<float> orientation;	// Unit quaternion and height, blocks of CueOrientationChannel
+	bool computed;
+};
+
+enum class PackedLayout {
+	Auto,			// Detected from the channel names
+	Interleaved,	// h1 r1 p1 y1 h2 r2 ...
+	Grouped			// h1 h2 ... r1 r2 ... p1 p2 ... y1 y2 ...
+};
+
+// Routes one channel of the Additional DMX input onto a fixture slot
+struct DMXRoute {
+	int32_t inputIndex;	// Channel index in the DMX input CHOP
+	int32_t fixture;	// 0-based fixture index
+	int32_t slot;		// Fixture-relative slot (1-80)
 };
 
 
@@ -126,6 +1008,16 @@ public:
 	virtual void		setupParameters(OP_ParameterManager* manager, void *reserved1) override;
 	virtual void		pulsePressed(const char* name, void* reserved1) override;
 	virtual void		buildDynamicMenu(const OP_Inputs* inputs, OP_BuildDynamicMenuInfo* info, void* reserved1) override;
+	virtual void		getWarningString(OP_String* warning, void* reserved1) override;
+
+	// Heap allocations made by the last execute(), see KINETIC_ALLOC_AUDIT
+	uint64_t			getCookAllocations() const { return myCookAllocations; }
+
+	// Batch kinematics for the Python API, with the mapping of the last cook.
+	// 'poses' holds count rows of height, roll, pitch and yaw, or of height
+	// and a plane normal if 'planes' is set. Writes 3 motor heights and 3
+	// DMX values per row; fixtures out of range get DMX 0.
+	void				solvePoses(const float* poses, size_t count, bool planes, float* motorHeights, uint8_t* motorDMX) const;
 
 //private:
 //
@@ -144,11 +1036,323 @@ public:
 //	std::unique_ptr<KineticLight> kineticLight;
 
 protected:
-	std::unique_ptr<KineticLight> kineticLight;
+	// Rebuilds myDMXRoutes when the channel set of the DMX input changes
+	void updateDMXRoutes(const OP_CHOPInput* dmxInput);
+
+	// Copy this cook's mapping, smoothing and prediction parameters into 'in'
+	void snapshotParameters(const OP_Inputs* inputs, FrameInputs& in);
+
+	// How many of the pose CHOPs' newest samples the filters haven't seen
+	int32_t newPoseSamples(const OP_Inputs* inputs);
+
+	// Copy this cook's pose into 'in', from the pose CHOPs or the Pose SOP.
+	// snapshotCHOPPose() takes up to maxSamples ending 'back' samples before
+	// the newest.
+	void snapshotCHOPPose(const OP_Inputs* inputs, FrameInputs& in, int32_t maxSamples, int32_t back);
+	void snapshotSOPPose(const OP_Inputs* inputs, FrameInputs& in);
+	void snapshotTOPPose(const OP_Inputs* inputs, FrameInputs& in);
+
+	void snapshotCuePose(const OP_Inputs* inputs, FrameInputs& in);
+
+	// Works out the texels each fixture samples from a height map of the given size
+	void updateTOPSampling(uint32_t width, uint32_t height);
+
+	// Works out where each pose channel sits in a packed pose input when its
+	// channel set or the requested layout changes, and checks the Pose SOP's
+	// orientation attribute
+	void updatePoseLayout(const OP_Inputs* inputs);
+
+	// Reloads the cues when the Cue DAT, Cue File or fixture count changes,
+	// and finds the cue named by the Cue parameter
+	void updateCues(const OP_Inputs* inputs);
+	void loadCues(const std::vector<std::vector<std::string>>& table);
+	void computeCue(Cue& cue, const MotorMapping& mapping);
+
+	// Resizes the fixture list and reloads the patch when the fixture
+	// count, start address or Patch DAT contents change
+	void updatePatch(const OP_Inputs* inputs);
+	void buildPatch(const OP_DATInput* patchDAT, int32_t startUniverse, int32_t startAddress, size_t numFixtures,
+					std::vector<FixturePatch>& patches, std::string& warning) const;
+	void loadPatch(int32_t startUniverse);
+
+	// Finds the neighbouring fixture pairs when the patch, Fixture Radius or
+	// Grid Spacing changes, so each cook only visits those pairs
+	void updateCollisionPairs(const OP_Inputs* inputs);
+
+	// Pushes the heights of neighbouring fixtures apart where their tilted
+	// plates would come closer than the clearance
+	void avoidCollisions(const FrameInputs& in, float* heights, const float* motorHeights);
+
+	// Turns one pose, laid out like a row of FrameInputs::poseSamples, into
+	// motor DMX values through collision avoidance and the safety envelope
+	void solveMotors(const FrameInputs& in, float* pose, float elapsed, float* motorHeights, uint8_t* motorDMX, bool* fixtureValid);
+
+	// Copies every fixture's slot block to its patched universe address
+	void packUniverses();
+
+	// Computes a frame into kineticLights and myUniverses. Runs in execute(),
+	// or on the worker thread in async mode. Returns false if the pose is
+	// out of range.
+	bool computeFrame(const FrameInputs& in);
+
+	// Writes a frame to the output. When resampling, the motor channels of
+	// the samples before the newest come from numSampleMotors blocks of
+	// sampleMotors, 3 motor heights per fixture.
+	void writeOutput(CHOP_Output* output, bool valid, const uint8_t* slots, const uint8_t* universes,
+					 const uint8_t* sampleMotors = nullptr, int32_t numSampleMotors = 0);
+
+	// Outputs a frame and hands it to the recorder and the sender. An
+	// invalid frame is replaced by the last valid one, and is only output
+	// as zeros, and never sent, when there is none.
+	void outputFrame(CHOP_Output* output, bool valid, const uint8_t* slots, const uint8_t* universes,
+					 const uint8_t* sampleMotors = nullptr, int32_t numSampleMotors = 0);
+
+	// Async cook: execute() publishes its inputs to a worker thread and
+	// outputs the newest completed frame. The worker is paused whenever the
+	// layout changes, since it owns the fixtures and buffers while running.
+	void updateAsync(const OP_Inputs* inputs);
+	void startWorker();
+	void stopWorker();
+	void pauseWorker();
+	void workerLoop();
+
+	// Baked shows: bakeShow() copies the whole length of the CHOP inputs and
+	// starts bakeLoop() on a thread, running them through a copy of the node
+	// into a file. finishBake() collects it and cancelBake() stops it early.
+	// playBake() decodes the frame for the current timeline frame or Play
+	// Index into the fixtures' slots. Recordings share the format and play
+	// the same way.
+	void updateBake(const OP_Inputs* inputs);
+	void updateRecord(const OP_Inputs* inputs);
+	bool bakeShow(const OP_Inputs* inputs, const char* path);
+	void bakeLoop();
+	void finishBake();
+	void cancelBake();
+	bool openBake(const char* path);
+	void closeBake();
+	bool playBake(const OP_TimeInfo* time);
+
+	// Start, restart or stop the sender and loopback receiver when the Send
+	// page or the universes change
+	void updateSender(const OP_Inputs* inputs);
+	void updateReceiver(const OP_Inputs* inputs);
+
+	// Starts, restarts or stops the motor feedback receiver when the Feedback
+	// page or the fixture count changes
+	void updateFeedback(const OP_Inputs* inputs);
+
+	// Sizes the input and output frames after a layout change
+	void resizeFrames();
+
+	// Rebuilds the output channel name table after a layout or patch change
+	void updateChannelNames();
+
+	FixtureArena kineticLights;
+	// myArenaExhausted is set when the last computed frame ran out of arena,
+	// myOutputArenaExhausted when the frame execute() last output did
+	FrameArena myFrameArena;
+	bool myArenaExhausted;
+	bool myOutputArenaExhausted;
+	MotorMapping myMapping;
+	uint64_t myCookAllocations;
 	int32_t myExecuteCount;
 	double myOffset;
 	const OP_NodeInfo* myNodeInfo;
 
+	// Name based routing for the Additional DMX input. Channels named
+	// 'f<fixture>_dmx<slot>' (or 'dmx<slot>' for the first fixture) are
+	// resolved once per channel set change; if no channel follows that
+	// scheme the input is read positionally (channel i-1 feeds CH i).
+	std::vector<DMXRoute> myDMXRoutes;
+	std::vector<std::string> myDMXRouteNames;
+	uint32_t myDMXRouteOpId;
+	int64_t myDMXRouteCooks;
+	bool myDMXRoutesByName;
+	bool myDMXRoutesDirty;
+	int32_t myDMXUnrouted;
+
+	// Packed pose input. Fixture f's value of pose channel c is input
+	// channel myPoseChannelBase[c] + f * myPoseChannelStride.
+	PoseInputMode myPoseInputMode;
+	PackedLayout myPackedLayout;
+	std::vector<const char*> myPoseLayoutNames;
+	uint32_t myPoseLayoutOpId;
+	int32_t myPoseChannelBase[NUM_POSE_CHANNELS];
+	int32_t myPoseChannelStride;
+	int32_t myPackedFixtures;
+	const char* myPoseWarning;
+
+	// The pose input whose samples the filters were last fed, and the index
+	// just past its newest sample
+	uint32_t myPoseInputId;
+	int64_t myPoseInputCooks;
+	double myPoseInputEnd;
+
+	// Pose TOP height map. A download started in one cook is sampled in the
+	// next, so the cook never waits on the readback. Each fixture reads the
+	// 2x2 texels around its patched UV: myTOPTexel[f] is the bottom left one,
+	// myTOPStepX/Y step to its neighbours.
+	OP_SmartRef<OP_TOPDownloadResult> myTOPDownload;
+	uint32_t myTOPWidth;
+	uint32_t myTOPHeight;
+	int32_t myTOPStepX;
+	int32_t myTOPStepY;
+	std::vector<int32_t> myTOPTexel;
+	std::vector<float> myTOPFracX;
+	std::vector<float> myTOPFracY;
+
+	// Baked show playback. myBakeDecodedFrame is the frame currently held
+	// in the fixtures' slots, or -1.
+	MappedFile myBakeFile;
+	const BakeHeader* myBakeHeader;
+	const BakeFrameEntry* myBakeIndex;
+	std::string myBakePath;
+	std::string myBakeWarning;
+	bool myBakePlayback;
+	bool myBakePending;
+
+	// Bake in progress. myBaker is the node bakeLoop() computes frames
+	// through; it has this node's layout as of the Bake Show pulse, and
+	// filters of its own. The inputs of every frame are in myBakePoses,
+	// myBakeSpeeds and myBakeDMX.
+	std::unique_ptr<CPlusPlusCHOPExample> myBaker;
+	BakeWriter myBakeWriter;
+	FrameInputs myBakeInputs;
+	std::vector<float> myBakePoses;
+	std::vector<float> myBakeSpeeds;
+	std::vector<float> myBakeDMX;
+	std::string myBakingPath;
+	int32_t myBakeFrames;
+	std::thread myBakeThread;
+	std::atomic<int32_t> myBakeFramesDone;
+	std::atomic<bool> myBakeCancel;
+	std::atomic<bool> myBakeFinished;
+	bool myBakeWritten;
+	bool myPlayByIndex;
+	int32_t myPlayIndex;
+	int64_t myBakeDecodedFrame;
+
+	// Recording of the live output. myRecordParam is the Record toggle as
+	// of the last cook: turning it on makes a recording pending until the
+	// previous one has finished writing.
+	FrameRecorder myRecorder;
+	bool myRecordParam;
+	bool myRecordPending;
+	const char* myRecordWarning;
+
+	// DMX over the network. execute() publishes each frame's universes, the
+	// sender's thread sends them at the Send Rate.
+	DMXSender mySender;
+
+	// Loopback receiver, checking the sender's packets as they arrive
+	DMXReceiver myReceiver;
+
+	// Closed loop. execute() snapshots the reported motor heights into the
+	// frame's inputs, and computeFrame() corrects the targets from them.
+	// myFeedbackError is the mean error of the last computed frame, and
+	// myOutputFeedbackError that of the frame execute() last output.
+	FeedbackReceiver myFeedback;
+	FeedbackCorrector myCorrector;
+	size_t myFeedbackMotors;
+	float myFeedbackError;
+	float myOutputFeedbackError;
+
+	// Cues. The crossfade runs from myCueFrom, the blend when the target
+	// changed, to myCues[myCueTarget]; myCueBlend is the last cook's blend.
+	// Cue motor values are computed with myCueMapping.
+	std::vector<Cue> myCues;
+	MotorMapping myCueMapping;
+	std::string myCueName;
+	int32_t myCueTarget;
+	int32_t myCueFadeTarget;
+	float myCueFade;
+	std::vector<uint16_t> myCueFrom;
+	std::vector<uint16_t> myCueBlend;
+	std::vector<uint8_t> myCueFromValid;
+	std::vector<uint8_t> myCueBlendValid;
+	// The orientation fade slerps from myCueFromOrientation, flipped into the
+	// target's hemisphere, through myCueSlerpAngle per fixture
+	std::vector<float> myCueFromOrientation;
+	std::vector<float> myCueBlendOrientation;
+	std::vector<float> myCueSlerpAngle;
+	uint32_t myCueDATId;
+	int64_t myCueDATCooks;
+	std::string myCueFile;
+	size_t myCueFixtures;
+	bool myCueReload;
+	const char* myCueWarning;
+
+	// Patch and universe output. myUniverses holds myNumUniverses * 512
+	// slots starting at myFirstUniverse, allocated when the patch changes.
+	OutputMode myOutputMode;
+	UniverseLayout myUniverseLayout;
+	std::vector<FixturePatch> myPatch;
+	std::vector<uint8_t> myUniverses;
+	int32_t myFirstUniverse;
+	int32_t myNumUniverses;
+	int32_t myPatchFixtures;
+	int32_t myPatchStartUniverse;
+	int32_t myPatchStartAddress;
+	uint32_t myPatchDATId;
+	int64_t myPatchDATCooks;
+	std::vector<FixturePatch> myNextPatch;		// Scratch for comparing a Patch DAT cook with myPatch
+	std::string myPatchWarning;					// Patch DAT warnings behind myPatch
+	std::string myWarning;
+
+	// Neighbour pairs for collision avoidance, found with myCollisionRadius
+	// and myCollisionSpacing. Read by computeFrame(), rebuilt with the worker paused.
+	std::vector<CollisionPair> myCollisionPairs;
+	float myCollisionRadius;
+	float myCollisionSpacing;
+	bool myCollisionPairsDirty;
+
+	// Output channel names, stored back to back as null terminated strings
+	// and served from here by getChannelName()
+	std::vector<char> myChannelNames;
+	std::vector<uint32_t> myChannelNameOffsets;
+	OutputMode myChannelNamesMode;
+	UniverseLayout myChannelNamesLayout;
+	bool myChannelNamesDirty;
+
+	TripleBuffer<FrameInputs> myInputFrames;
+	TripleBuffer<FrameOutput> myOutputFrames;
+	PoseSmoother mySmoother;
+	PosePredictor myPredictor;
+	SafetyEnvelope mySafety;
+
+	// Each fixture's SafetyLimitBits from computeFrame(), and from the frame
+	// execute() last output, for the Info DAT
+	std::vector<uint8_t> myLimitHits;
+	std::vector<uint8_t> myOutputLimitHits;
+
+	// Motor values of the resampled output samples before the newest, from computeFrame()
+	std::vector<uint8_t> mySampleMotors;
+	int32_t myNumSampleMotors;
+	uint64_t myFrameCount;
+	bool myLayoutChanged;
+
+	// The last valid frame output, held in place of invalid frames. Kept
+	// across layout changes that don't change its size. myHeldFrames counts
+	// the cooks that output it.
+	std::vector<uint8_t> myHeldSlots;
+	std::vector<uint8_t> myHeldUniverses;
+	bool myHaveHeldFrame;
+	uint64_t myHeldFrames;
+
+	std::thread myWorker;
+	std::mutex myWorkerMutex;
+	std::condition_variable myWorkerWake;
+	std::condition_variable myWorkerDone;
+	bool myWorkerRunning;
+	int32_t myAsyncLatency;
+	bool myAwaitWorker;			// The next cook waits for its own frame, set after the frames reset
+
+	// Protected by myWorkerMutex
+	bool myWorkerQuit;
+	bool myWorkPending;
+	bool myWorkerBusy;
+	uint64_t myCompletedFrame;
+
 
 
 };
@@ -0,0 +1,107 @@
+/* Loopback benchmark for DMXSocket. Sends Art-Net frames to 127.0.0.1 as
+* fast as the socket takes them, once batching each frame into sendmmsg()
+* calls and once with a sendto() call per packet, and reports universes
+* sent per second for both. With -r a DMXReceiver listens on the Art-Net
+* port and checks what arrives.
+*
+* Linux or macOS, from the repository root:
+*
+*   g++ -std=c++17 -O2 -include cstdint -include cstddef -D__cdecl= -fpermissive \
+*       -I. bench/DMXLoopbackBench.cpp KineticCHOP.cpp -o dmxbench -lpthread
+*   ./dmxbench [-u universes] [-s seconds] [-r]
+*
+* The flags let g++ and clang take the TouchDesigner SDK headers, which are
+* written for MSVC. Batching is Linux only, so elsewhere both runs send a
+* call per packet.
+*/
+
+#include "KineticCHOP.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+const uint16_t ARTNET_PORT = 6454;
+
+static int64_t steadyNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Sends for 'seconds' and prints the rates
+static void run(bool batched, int32_t numUniverses, double seconds, bool receive) {
+	DMXSocket socket;
+	if (!socket.open(DMXProtocol::ArtNet, "127.0.0.1", 0, numUniverses)) {
+		fprintf(stderr, "Couldn't open a socket to 127.0.0.1\n");
+		exit(1);
+	}
+	socket.setBatched(batched);
+
+	SendLog log;
+	log.reset(numUniverses);
+	DMXReceiver receiver;
+	if (receive && !receiver.start(ARTNET_PORT, &log, 0, numUniverses)) {
+		fprintf(stderr, "Couldn't listen on port %d\n", ARTNET_PORT);
+		exit(1);
+	}
+
+	std::vector<uint8_t> universes(static_cast<size_t>(numUniverses) * DMX_UNIVERSE_SIZE);
+	uint64_t frames = 0;
+	uint64_t failures = 0;
+	uint8_t sequence = 0;
+	int64_t start = steadyNanoseconds();
+	int64_t end = start + static_cast<int64_t>(seconds * 1e9);
+	int64_t now = start;
+	while (now < end) {
+		memset(universes.data(), static_cast<int>(frames & 0xff), universes.size());
+		sequence = sequence == 255 ? 1 : sequence + 1;
+		log.record(sequence, universes.data(), now);
+		if (!socket.send(universes.data(), sequence))
+			failures++;
+		frames++;
+		now = steadyNanoseconds();
+	}
+	double elapsed = (now - start) * 1e-9;
+
+	printf("%-10s %10.0f universes/s", batched ? "sendmmsg" : "sendto", frames * numUniverses / elapsed);
+	if (failures)
+		printf(", %llu frames failed", static_cast<unsigned long long>(failures));
+	if (receive) {
+		// Let the last packets arrive
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		printf(", %10.0f received/s, %llu lost, %llu mismatched", receiver.getPacketsReceived() / elapsed,
+			   static_cast<unsigned long long>(receiver.getPacketsLost()),
+			   static_cast<unsigned long long>(receiver.getMismatches()));
+		receiver.stop();
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv) {
+	int32_t numUniverses = 64;
+	double seconds = 2.0;
+	bool receive = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+			numUniverses = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "-r") == 0)
+			receive = true;
+		else {
+			fprintf(stderr, "Usage: %s [-u universes] [-s seconds] [-r]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (numUniverses < 1 || numUniverses > 32768 || seconds <= 0) {
+		fprintf(stderr, "Universes go from 1 to 32768, and seconds have to be positive\n");
+		return 2;
+	}
+
+	printf("%d universes a frame, %g s a run\n", numUniverses, seconds);
+	run(true, numUniverses, seconds, receive);
+	run(false, numUniverses, seconds, receive);
+	return 0;
+}
@@ -0,0 +1,121 @@
+/* Cooks the node headless in a loop under several configurations and
+* checks that execute() makes no heap allocations once the layout is set,
+* and that no frame runs out of the frame arena.
+*
+* Allocations are counted by replacing the global allocation functions of
+* this executable only; the plugin itself never replaces them. Build with
+* KINETIC_ALLOC_AUDIT so KineticCHOP.cpp takes threadAllocationCount()
+* from here and its own asserts are live too.
+*/
+
+#include "TestInputs.h"
+
+#include <new>
+
+#ifndef KINETIC_ALLOC_AUDIT
+#error AllocationTest has to be built with KINETIC_ALLOC_AUDIT
+#endif
+
+static thread_local uint64_t theAllocationCount = 0;
+
+void* operator new(size_t size) {
+	theAllocationCount++;
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	theAllocationCount++;
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	theAllocationCount++;
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	theAllocationCount++;
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+uint64_t threadAllocationCount() {
+	return theAllocationCount;
+}
+
+const int WARMUP_COOKS = 5;
+const int COOKS = 200;
+
+struct Configuration {
+	const char* name;
+	std::map<std::string, double> numbers;
+};
+
+static void cookLoop(const Configuration& configuration) {
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+
+	TestInputs inputs;
+	inputs.numbers["Minheight"] = -3;
+	inputs.numbers["Fixtures"] = 40;
+	for (const auto& number : configuration.numbers)
+		inputs.numbers[number.first] = number.second;
+
+	TestCHOP height({ "height" }, { 1.0f }, 1);
+	TestCHOP roll({ "roll" }, { 10.0f }, 2);
+	TestCHOP pitch({ "pitch" }, { 5.0f }, 3);
+	TestCHOP yaw({ "yaw" }, { 0.0f }, 4);
+	TestCHOP speed({ "speed" }, { 100.0f }, 5);
+	TestCHOP dmx({ "f2_dmx4", "f3_dmx5" }, { 44.0f, 55.0f }, 6);
+	inputs.chops = { &height.input, &roll.input, &pitch.input, &yaw.input, &speed.input, &dmx.input };
+
+	TestCook cook;
+	for (int i = 0; i < WARMUP_COOKS + COOKS; i++) {
+		// Moving inputs so every stage has work to do
+		height.set(0, 1.0f + 0.5f * static_cast<float>(sin(i * 0.1)));
+		roll.set(0, 10.0f * static_cast<float>(cos(i * 0.07)));
+		pitch.set(0, 5.0f * static_cast<float>(sin(i * 0.05)));
+		inputs.time.absFrame = i;
+		inputs.time.frame = i;
+
+		cook.run(node, inputs);
+		CHECK(cook.outputInfo.numChannels > 0, "%s: no output channels", configuration.name);
+		// The arena is sized up front, so no cook runs out of it
+		TestString warning;
+		node.getWarningString(&warning, nullptr);
+		CHECK(warning.text.find("arena") == std::string::npos, "%s: cook %d warned \"%s\"", configuration.name, i,
+			  warning.text.c_str());
+		if (i >= WARMUP_COOKS) {
+			CHECK(cook.executeAllocations == 0, "%s: cook %d allocated %llu times in execute()", configuration.name, i,
+				  static_cast<unsigned long long>(cook.executeAllocations));
+			CHECK(node.getCookAllocations() == 0, "%s: cook %d counted %llu allocations", configuration.name, i,
+				  static_cast<unsigned long long>(node.getCookAllocations()));
+		}
+	}
+	printf("%-24s %d cooks, no allocations\n", configuration.name, COOKS);
+}
+
+int main() {
+	const Configuration configurations[] = {
+		{ "channels", {} },
+		{ "universes", { { "Outputmode", 1 } } },
+		{ "one euro smoothing", { { "Smoothmode", 1 } } },
+		{ "spring smoothing", { { "Smoothmode", 2 } } },
+		{ "kalman prediction", { { "Predictmode", 3 } } },
+		{ "collision avoidance", { { "Avoidcollisions", 1 } } },
+		{ "safety", { { "Safety", 1 } } },
+		{ "resampling", { { "Resample", 1 }, { "Outputrate", 120 } } },
+		{ "async", { { "Async", 1 } } },
+	};
+	for (const Configuration& configuration : configurations)
+		cookLoop(configuration);
+	return 0;
+}
@@ -0,0 +1,187 @@
+/* Writes a baked show file and reads it back: the header, raw keyframes and
+* delta frames through applyBakeFrame(). Then bakes a show through the node,
+* checking the live output carries on undisturbed while the bake runs in
+* the background, and that the baked frames play back as computed.
+*/
+
+#include "TestInputs.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <unistd.h>
+
+const int32_t FIXTURES = 4;
+
+// The first motor's DMX value of 'fixture', in Channels output
+static float motorValue(const TestCook& cook, int32_t fixture) {
+	return cook.output->channels[fixture * KineticLight::NUM_SLOTS + KineticLight::motorSlot(1) - 1][0];
+}
+
+// More than 0xFFFF slots, so delta runs need splitting
+static void roundTrip(const std::string& path) {
+	const size_t numFixtures = 1000;
+	const size_t numSlots = numFixtures * KineticLight::NUM_SLOTS;
+	const uint32_t keyframeInterval = 4;
+	const int numFrames = 11;
+
+	std::mt19937 random(7);
+	std::vector<uint8_t> slots(numSlots, 0);
+	std::vector<std::vector<uint8_t>> frames;
+	for (int f = 0; f < numFrames; f++) {
+		if (f == 5) {
+			// Every slot changes, so the frame is stored raw
+			for (uint8_t& slot : slots)
+				slot = static_cast<uint8_t>(slot + 1 + random() % 255);
+		}
+		else if (f != 6) {
+			// A change at each end, and a few runs in between
+			slots[f] = static_cast<uint8_t>(random());
+			slots[numSlots - 1 - f] = static_cast<uint8_t>(random());
+			for (int i = 0; i < 20; i++)
+				slots[random() % numSlots] = static_cast<uint8_t>(random());
+		}
+		frames.push_back(slots);
+	}
+
+	BakeWriter writer;
+	CHECK(writer.open(path.c_str(), numFixtures, keyframeInterval, true, 12.0, 30.0), "couldn't open %s", path.c_str());
+	for (const std::vector<uint8_t>& frame : frames)
+		CHECK(writer.write(frame.data()), "couldn't write a frame");
+	CHECK(writer.close(), "couldn't close the file");
+
+	MappedFile file;
+	CHECK(file.open(path.c_str()), "couldn't map %s", path.c_str());
+	const uint8_t* data = file.data();
+	const BakeHeader* header = reinterpret_cast<const BakeHeader*>(data);
+	CHECK(!memcmp(header->magic, BAKE_MAGIC, sizeof(header->magic)), "wrong magic");
+	CHECK(header->version == BAKE_VERSION, "version is %u", header->version);
+	CHECK(header->numFixtures == numFixtures, "numFixtures is %u", header->numFixtures);
+	CHECK(header->numFrames == numFrames, "numFrames is %u", header->numFrames);
+	CHECK(header->keyframeInterval == keyframeInterval, "keyframeInterval is %u", header->keyframeInterval);
+	CHECK(header->startIndex == 12.0 && header->sampleRate == 30.0, "start %g at %g fps", header->startIndex,
+		  header->sampleRate);
+	CHECK(header->indexOffset + numFrames * sizeof(BakeFrameEntry) <= file.size(), "the index is past the end");
+
+	const BakeFrameEntry* index = reinterpret_cast<const BakeFrameEntry*>(data + header->indexOffset);
+	for (int f = 0; f < numFrames; f++) {
+		bool keyframe = f % keyframeInterval == 0;
+		CHECK(index[f].delta == (keyframe || f == 5 ? 0u : 1u), "frame %d has delta %u", f, index[f].delta);
+	}
+
+	// In order, each frame applies on top of the one before
+	std::vector<uint8_t> decoded(numSlots, 0);
+	for (int f = 0; f < numFrames; f++) {
+		CHECK(applyBakeFrame(data, index[f], decoded.data(), numSlots), "frame %d is malformed", f);
+		CHECK(decoded == frames[f], "frame %d decoded differently", f);
+	}
+
+	// Or from the keyframe before it
+	std::vector<uint8_t> jumped(numSlots, 0xAA);
+	for (int f = 8; f <= 10; f++)
+		CHECK(applyBakeFrame(data, index[f], jumped.data(), numSlots), "frame %d is malformed", f);
+	CHECK(jumped == frames[10], "frame 10 decoded differently from keyframe 8");
+
+	// A run cut short is malformed
+	BakeFrameEntry cut = index[1];
+	cut.size -= 1;
+	CHECK(!applyBakeFrame(data, cut, decoded.data(), numSlots), "a cut run was applied");
+	file.close();
+	printf("%d frames of %zu slots read back as written\n", numFrames, numSlots);
+}
+
+struct Rig {
+	Rig(const ClipCHOP& height) : node(&nodeInfo), roll({ "roll" }, { 10.0f }, 2) {
+		inputs.numbers["Minheight"] = -3;
+		inputs.numbers["Fixtures"] = FIXTURES;
+		inputs.numbers["Smoothmode"] = 2;
+		inputs.numbers["Smoothspringtime"] = 0.5;
+		inputs.time.deltaMS = 1000.0 / 60.0;
+		inputs.chops = { &height.input, &roll.input };
+	}
+
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node;
+	TestInputs inputs;
+	TestCHOP roll;
+	TestCook cook;
+};
+
+static void bakeInBackground(const std::string& path) {
+	const int numFrames = 20000;
+	std::vector<float> heights;
+	for (int s = 0; s < numFrames; s++)
+		heights.push_back(2.0f + 0.5f * static_cast<float>(sin(s * 0.01)));
+	ClipCHOP height("height", heights, 1);
+
+	// One node bakes while the other never does. Their live output stays
+	// the same throughout.
+	Rig baking(height), live(height);
+	baking.inputs.strings["Bakefile"] = path;
+	baking.inputs.numbers["Bakedelta"] = 1;
+	baking.inputs.numbers["Bakekeyframe"] = 30;
+	auto cookBoth = [&](int i) {
+		baking.cook.run(baking.node, baking.inputs);
+		live.cook.run(live.node, live.inputs);
+		for (int32_t f = 0; f < FIXTURES; f++)
+			CHECK(motorValue(baking.cook, f) == motorValue(live.cook, f), "cook %d: fixture %d output %g while baking, %g without",
+				  i, f, motorValue(baking.cook, f), motorValue(live.cook, f));
+	};
+	// Roll steps just before the bake, so the live filters are moving
+	for (int i = 0; i < 3; i++) {
+		if (i == 2) {
+			baking.roll.set(0, 30.0f);
+			live.roll.set(0, 30.0f);
+		}
+		cookBoth(i);
+	}
+	baking.node.pulsePressed("Bake", nullptr);
+	int cooks = 0;
+	do {
+		CHECK(cooks < 10000, "the bake never finished, progress %g", infoChannel(baking.node, "bakeProgress"));
+		cookBoth(3 + cooks++);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	} while (infoChannel(baking.node, "bakeProgress") < 1.0f);
+	cookBoth(3 + cooks);
+	TestString warning;
+	baking.node.getWarningString(&warning, nullptr);
+	CHECK(warning.text.empty(), "the bake warned \"%s\"", warning.text.c_str());
+
+	// The baked frames are what a node fed the show a sample per cook outputs
+	const int checked[] = { 0, 1, 29, 30, 31, 1000, numFrames - 1 };
+	std::map<int, std::vector<float>> expected;
+	ClipCHOP first("height", { heights[0] }, 1);
+	Rig fresh(first);
+	fresh.roll.set(0, 30.0f);
+	TestCHOP sample({ "height" }, { heights[0] }, 1);
+	fresh.inputs.chops[0] = &sample.input;
+	for (int s = 0; s < numFrames; s++) {
+		sample.set(0, heights[s]);
+		fresh.cook.run(fresh.node, fresh.inputs);
+		for (int c : checked) {
+			if (c == s) {
+				for (int32_t f = 0; f < FIXTURES; f++)
+					expected[s].push_back(motorValue(fresh.cook, f));
+			}
+		}
+	}
+
+	baking.inputs.numbers["Bakeplay"] = 1;
+	baking.inputs.numbers["Playkey"] = 1;
+	for (int c : checked) {
+		baking.inputs.numbers["Playindex"] = c;
+		baking.cook.run(baking.node, baking.inputs);
+		for (int32_t f = 0; f < FIXTURES; f++)
+			CHECK(motorValue(baking.cook, f) == expected[c][f], "baked frame %d: fixture %d played %g instead of %g", c, f,
+				  motorValue(baking.cook, f), expected[c][f]);
+	}
+	printf("baked %d frames over %d live cooks without touching the live output\n", numFrames, cooks);
+}
+
+int main() {
+	std::string path = "/tmp/BakeTest-" + std::to_string(getpid()) + ".kdmx";
+	roundTrip(path);
+	bakeInBackground(path);
+	remove(path.c_str());
+	return 0;
+}
@@ -0,0 +1,55 @@
+/* Checks collision avoidance on two neighbouring fixtures whose plates only
+* come too close away from the line between their centers, and that the
+* heights it pushes stay within Min and Max Height.
+*/
+
+#include "TestInputs.h"
+
+// The first motor's DMX value of 'fixture', in Channels output
+static float motorValue(const TestCook& cook, int32_t fixture) {
+	return cook.output->channels[fixture * KineticLight::NUM_SLOTS + KineticLight::motorSlot(1) - 1][0];
+}
+
+// Two fixtures 0.6 apart along X with plates of radius 0.5. The first hangs
+// flat at 1.2. The second hangs at 1.0, tilted across the line between
+// them, so its plate rises above the first one's at the tips of their
+// overlap while staying 0.2 below it along the line.
+static std::vector<float> run(bool avoid, double maxHeight) {
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+	TestInputs inputs;
+	inputs.numbers["Minheight"] = -3;
+	inputs.numbers["Maxheight"] = maxHeight;
+	inputs.numbers["Fixtures"] = 2;
+	inputs.numbers["Avoidcollisions"] = avoid;
+	inputs.numbers["Fixtureradius"] = 0.5;
+	inputs.numbers["Gridspacing"] = 0.6;
+	inputs.numbers["Clearance"] = 0.05;
+	inputs.numbers["Collisioniterations"] = 4;
+	TestCHOP height({ "height1", "height2" }, { 1.2f, 1.0f }, 1);
+	TestCHOP roll({ "roll1", "roll2" }, { 0.0f, 30.0f }, 2);
+	TestCHOP pitch({ "pitch1", "pitch2" }, { 0.0f, 0.0f }, 3);
+	inputs.chops = { &height.input, &roll.input, &pitch.input };
+
+	TestCook cook;
+	cook.run(node, inputs);
+	return { motorValue(cook, 0), motorValue(cook, 1) };
+}
+
+int main() {
+	std::vector<float> free = run(false, 3.0);
+	std::vector<float> avoided = run(true, 3.0);
+	CHECK(avoided[0] > free[0], "the upper fixture wasn't pushed up: %g, %g without avoidance", avoided[0], free[0]);
+	CHECK(avoided[1] < free[1], "the lower fixture wasn't pushed down: %g, %g without avoidance", avoided[1], free[1]);
+	printf("plates that only meet off the line between them are pushed apart\n");
+
+	// At Max Height the upper fixture stays put and the lower one moves
+	std::vector<float> limited = run(true, 1.2);
+	std::vector<float> limitedFree = run(false, 1.2);
+	CHECK(limited[0] == limitedFree[0], "the upper fixture was pushed past Max Height: %g, %g without avoidance",
+		  limited[0], limitedFree[0]);
+	CHECK(limited[1] < limitedFree[1], "the lower fixture wasn't pushed down: %g, %g without avoidance", limited[1],
+		  limitedFree[1]);
+	printf("pushed heights stay within Min and Max Height\n");
+	return 0;
+}
@@ -0,0 +1,39 @@
+/* Checks that renaming a channel of the Additional DMX input reroutes it,
+* even when the new name is stored where the old one was.
+*/
+
+#include "TestInputs.h"
+
+// The DMX value of 'slot' of the first fixture, in Channels output
+static float slotValue(const TestCook& cook, int slot) {
+	return cook.output->channels[slot - 1][0];
+}
+
+int main() {
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+	TestInputs inputs;
+	inputs.numbers["Minheight"] = -3;
+	inputs.numbers["Fixtures"] = 1;
+	TestCHOP height({ "height" }, { 1.0f }, 1);
+	TestCHOP roll({ "roll" }, { 0.0f }, 2);
+	TestCHOP pitch({ "pitch" }, { 0.0f }, 3);
+	TestCHOP yaw({ "yaw" }, { 0.0f }, 4);
+	TestCHOP speed({ "speed" }, { 10.0f }, 5);
+	TestCHOP dmx({ "dmx10" }, { 200.0f }, 6);
+	inputs.chops = { &height.input, &roll.input, &pitch.input, &yaw.input, &speed.input, &dmx.input };
+
+	TestCook cook;
+	cook.run(node, inputs);
+	CHECK(slotValue(cook, 10) == 200.0f, "slot 10 is %g", slotValue(cook, 10));
+
+	// Same length, so the name keeps its storage
+	const char* before = dmx.input.nameData[0];
+	dmx.rename(0, "dmx11");
+	CHECK(dmx.input.nameData[0] == before, "the rename moved the name");
+	cook.run(node, inputs);
+	CHECK(slotValue(cook, 11) == 200.0f, "slot 11 is %g after the rename", slotValue(cook, 11));
+	CHECK(slotValue(cook, 10) == 0.0f, "slot 10 is still %g after the rename", slotValue(cook, 10));
+	printf("a channel renamed in place is rerouted\n");
+	return 0;
+}
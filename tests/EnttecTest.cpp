@@ -0,0 +1,129 @@
+/* Opens the slave side of a pseudo terminal as an ENTTEC DMX USB Pro port
+* and reads what EnttecPort writes from the master side. Checks the framing
+* of a "Send DMX Packet" message, then fills the terminal's buffer so a
+* message is only partly written, and checks that later calls finish it
+* without corrupting the stream.
+*/
+
+#include "TestInputs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+static void fillUniverse(uint8_t* slots, int seed) {
+	for (int i = 0; i < DMX_UNIVERSE_SIZE; i++)
+		slots[i] = static_cast<uint8_t>(seed * 31 + i);
+}
+
+// Reads everything the master has, waiting up to 'timeout' milliseconds
+// for the first bytes
+static std::vector<uint8_t> drain(int master, int timeout) {
+	std::vector<uint8_t> bytes;
+	uint8_t buffer[4096];
+	pollfd pfd = { master, POLLIN, 0 };
+	while (poll(&pfd, 1, bytes.empty() ? timeout : 50) > 0) {
+		ssize_t count = read(master, buffer, sizeof(buffer));
+		if (count <= 0)
+			break;
+		bytes.insert(bytes.end(), buffer, buffer + count);
+	}
+	return bytes;
+}
+
+// Checks one message at 'message' carries the universe made from 'seed'
+static void checkMessage(const uint8_t* message, int seed, const char* what) {
+	uint8_t slots[DMX_UNIVERSE_SIZE];
+	fillUniverse(slots, seed);
+	CHECK(message[0] == 0x7e, "%s: start delimiter is 0x%02x", what, message[0]);
+	CHECK(message[1] == 6, "%s: label is %d", what, message[1]);
+	CHECK(message[2] == (513 & 0xff) && message[3] == (513 >> 8), "%s: data length is %d", what,
+		  message[2] | message[3] << 8);
+	CHECK(message[4] == 0, "%s: start code is %d", what, message[4]);
+	CHECK(memcmp(message + 5, slots, DMX_UNIVERSE_SIZE) == 0, "%s: slots don't match", what);
+	CHECK(message[ENTTEC_MESSAGE_SIZE - 1] == 0xe7, "%s: end delimiter is 0x%02x", what,
+		  message[ENTTEC_MESSAGE_SIZE - 1]);
+}
+
+static void framing(int master, const char* path) {
+	EnttecPort port;
+	CHECK(port.open(path), "couldn't open %s", path);
+
+	uint8_t slots[DMX_UNIVERSE_SIZE];
+	fillUniverse(slots, 1);
+	CHECK(port.send(slots), "send failed");
+	CHECK(port.getPending() == 0, "%zu bytes left to write", port.getPending());
+
+	std::vector<uint8_t> bytes = drain(master, 1000);
+	CHECK(bytes.size() == ENTTEC_MESSAGE_SIZE, "read %zu bytes instead of %zu", bytes.size(), ENTTEC_MESSAGE_SIZE);
+	checkMessage(bytes.data(), 1, "message");
+	printf("framed a universe in %zu bytes\n", bytes.size());
+}
+
+static void partialWrites(int master, const char* path) {
+	EnttecPort port;
+	CHECK(port.open(path), "couldn't open %s", path);
+
+	// Nothing reads the master until a message is left partly written
+	uint8_t slots[DMX_UNIVERSE_SIZE];
+	int sent = 0;
+	while (port.getPending() == 0) {
+		CHECK(sent < 100000, "the terminal never filled up");
+		fillUniverse(slots, sent);
+		CHECK(port.send(slots), "send %d failed", sent);
+		sent++;
+	}
+	size_t pending = port.getPending();
+	CHECK(pending < ENTTEC_MESSAGE_SIZE, "message %d wasn't started", sent - 1);
+
+	// Universes passed in while the port is full are dropped
+	fillUniverse(slots, -1);
+	for (int i = 0; i < 10; i++) {
+		CHECK(port.send(slots), "send failed while the terminal was full");
+		CHECK(port.getPending() <= pending, "pending grew from %zu to %zu", pending, port.getPending());
+	}
+
+	// Making room lets the next calls finish the message they started
+	std::vector<uint8_t> bytes = drain(master, 1000);
+	int calls = 0;
+	while (port.getPending()) {
+		CHECK(calls++ < 1000, "the partly written message never finished");
+		CHECK(port.send(slots), "send failed while finishing");
+		std::vector<uint8_t> more = drain(master, 10);
+		bytes.insert(bytes.end(), more.begin(), more.end());
+	}
+
+	// And the one after that starts afresh
+	fillUniverse(slots, sent);
+	CHECK(port.send(slots), "send after finishing failed");
+	std::vector<uint8_t> more = drain(master, 1000);
+	bytes.insert(bytes.end(), more.begin(), more.end());
+
+	CHECK(bytes.size() == (sent + 1) * ENTTEC_MESSAGE_SIZE, "read %zu bytes instead of %zu messages", bytes.size(),
+		  static_cast<size_t>(sent + 1));
+	char what[64];
+	for (int m = 0; m <= sent; m++) {
+		snprintf(what, sizeof(what), "message %d", m);
+		checkMessage(&bytes[m * ENTTEC_MESSAGE_SIZE], m, what);
+	}
+	printf("resumed message %d after %zu of its bytes filled the terminal\n", sent - 1, ENTTEC_MESSAGE_SIZE - pending);
+}
+
+int main() {
+	int master, slave;
+	char path[256];
+	CHECK(openpty(&master, &slave, path, nullptr, nullptr) == 0, "openpty failed: %s", strerror(errno));
+
+	framing(master, path);
+	partialWrites(master, path);
+
+	close(slave);
+	close(master);
+	return 0;
+}
@@ -0,0 +1,222 @@
+/* Runs FeedbackCorrector against simulated motors: first-order lags that
+* settle a steady sag below their command, reporting their position a cook
+* late. The correction has to pull the motors onto their targets without
+* ever going past Feedback Max, integrate each report once however many
+* cooks read it, and apply to cue playback as well as to live poses.
+*/
+
+#include "TestInputs.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cmath>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+const float ELAPSED = 1.0f / 60.0f;
+const float TIME_CONSTANT = 0.15f;		// Seconds for a motor to cover 63% of a step
+const float SAG = 0.04f;				// How far below its command a motor settles
+const size_t MOTORS = 6;
+
+struct SimulatedMotor {
+	float position = 0.0f;
+
+	void step(float command) {
+		float alpha = 1.0f - std::exp(-ELAPSED / TIME_CONSTANT);
+		position += (command - SAG - position) * alpha;
+	}
+};
+
+static FeedbackParams pid() {
+	FeedbackParams params = FeedbackParams();
+	params.enabled = true;
+	params.kp = 0.3f;
+	params.ki = 2.0f;
+	params.kd = 0.002f;
+	params.maxCorrection = 0.1f;
+	params.timeout = 0.5f;
+	return params;
+}
+
+// Holds the targets still until the error settles, then steps them by more
+// than the proportional term may correct and checks that the rig settles
+// again
+static void convergence() {
+	const FeedbackParams params = pid();
+	FeedbackCorrector corrector;
+	corrector.resize(MOTORS);
+
+	SimulatedMotor motors[MOTORS];
+	float targets[MOTORS];
+	float measured[MOTORS];
+	float fresh[MOTORS];
+	int64_t times[MOTORS];
+	float commands[MOTORS];
+	for (size_t m = 0; m < MOTORS; m++) {
+		targets[m] = 1.0f + 0.1f * m;
+		motors[m].position = targets[m] - SAG;
+		measured[m] = motors[m].position;
+		fresh[m] = 1.0f;
+		times[m] = 1;
+	}
+
+	float error = 0.0f;
+	for (int cook = 0; cook < 1200; cook++) {
+		if (cook == 600) {
+			for (size_t m = 0; m < MOTORS; m++)
+				targets[m] += 0.5f;
+		}
+
+		for (size_t m = 0; m < MOTORS; m++)
+			commands[m] = targets[m];
+		error = corrector.process(commands, measured, fresh, times, MOTORS, ELAPSED, params);
+		for (size_t m = 0; m < MOTORS; m++) {
+			float correction = commands[m] - targets[m];
+			CHECK(std::abs(correction) <= params.maxCorrection + 1e-6f, "cook %d: motor %zu corrected by %g", cook,
+				  m, correction);
+			measured[m] = motors[m].position;
+			times[m]++;
+			motors[m].step(commands[m]);
+		}
+
+		if (cook == 599 || cook == 1199) {
+			CHECK(error < 1e-3f, "cook %d: mean error %g hasn't settled", cook, error);
+			for (size_t m = 0; m < MOTORS; m++)
+				CHECK(std::abs(motors[m].position - targets[m]) < 1e-3f, "cook %d: motor %zu is %g off its target",
+					  cook, m, motors[m].position - targets[m]);
+		}
+	}
+	printf("settled to a mean error of %g with a sag of %g\n", error, SAG);
+}
+
+// With only a derivative term, the first report after a gap corrects
+// nothing, however far the motor moved meanwhile
+static void derivativeAfterGap() {
+	FeedbackParams params = pid();
+	params.kp = 0.0f;
+	params.ki = 0.0f;
+	params.kd = 1.0f;
+	params.maxCorrection = 10.0f;
+	FeedbackCorrector corrector;
+	corrector.resize(1);
+
+	float target = 1.0f;
+	float measured = 0.5f;
+	float fresh = 1.0f;
+	int64_t time = 1;
+	corrector.process(&target, &measured, &fresh, &time, 1, ELAPSED, params);
+
+	fresh = 0.0f;
+	for (int cook = 0; cook < 10; cook++) {
+		target = 1.0f;
+		corrector.process(&target, &measured, &fresh, &time, 1, ELAPSED, params);
+		CHECK(target == 1.0f, "stale cook %d corrected by %g", cook, target - 1.0f);
+	}
+
+	fresh = 1.0f;
+	target = 1.0f;
+	measured = 0.9f;
+	time = 2;
+	corrector.process(&target, &measured, &fresh, &time, 1, ELAPSED, params);
+	CHECK(target == 1.0f, "first report after the gap corrected by %g", target - 1.0f);
+
+	target = 1.0f;
+	measured = 0.95f;
+	time = 3;
+	corrector.process(&target, &measured, &fresh, &time, 1, ELAPSED, params);
+	float expected = (0.05f - 0.1f) / ELAPSED;
+	CHECK(std::abs(target - 1.0f - expected) < 1e-3f, "second report corrected by %g instead of %g", target - 1.0f,
+		  expected);
+	printf("no derivative kick after a gap in reports\n");
+}
+
+// With only an integral term, a report read by several cooks is integrated
+// once, and the next one over the time since
+static void reportIntegratedOnce() {
+	FeedbackParams params = pid();
+	params.kp = 0.0f;
+	params.ki = 1.0f;
+	params.kd = 0.0f;
+	params.maxCorrection = 10.0f;
+	FeedbackCorrector corrector;
+	corrector.resize(1);
+
+	float measured = 0.9f;
+	float fresh = 1.0f;
+	int64_t time = 1;
+	float target = 1.0f;
+	for (int cook = 0; cook < 10; cook++) {
+		target = 1.0f;
+		corrector.process(&target, &measured, &fresh, &time, 1, ELAPSED, params);
+	}
+	float expected = 0.1f * ELAPSED;
+	CHECK(std::abs(target - 1.0f - expected) < 1e-5f, "a report read by 10 cooks integrated to %g instead of %g",
+		  target - 1.0f, expected);
+
+	time = 2;
+	target = 1.0f;
+	corrector.process(&target, &measured, &fresh, &time, 1, ELAPSED, params);
+	expected += 0.1f * 10 * ELAPSED;
+	CHECK(std::abs(target - 1.0f - expected) < 1e-5f, "the next report integrated to %g instead of %g",
+		  target - 1.0f, expected);
+	printf("a report is integrated once, however many cooks read it\n");
+}
+
+// Cooks a fixture playing a cue at 1.5 whose motors report 1.3, and returns
+// its first motor's DMX value
+static float cueMotorValue(bool feedback) {
+	const uint16_t port = 46456;
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+	TestInputs inputs;
+	inputs.numbers["Minheight"] = -3;
+	inputs.numbers["Fixtures"] = 1;
+	inputs.numbers["Poseinput"] = 4;
+	inputs.strings["Cue"] = "a";
+	TestDAT cues({ { "cue", "fixture", "height", "roll", "pitch", "yaw" }, { "a", "", "1.5", "0", "0", "0" } }, 7);
+	inputs.dats["Cuedat"] = &cues.input;
+	inputs.numbers["Feedback"] = feedback;
+	inputs.numbers["Feedbackport"] = port;
+	inputs.numbers["Feedbacktimeout"] = 1.0;
+	inputs.numbers["Feedbackkp"] = 0.5;
+	inputs.numbers["Feedbackmax"] = 0.2;
+	inputs.time.deltaMS = 1000.0 / 60.0;
+	TestCook cook;
+	cook.run(node, inputs);
+
+	if (feedback) {
+		int sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		sockaddr_in destination = {};
+		destination.sin_family = AF_INET;
+		destination.sin_port = htons(port);
+		destination.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		const char report[] = "1 1 1.3\n1 2 1.3\n1 3 1.3\n";
+		sendto(sender, report, sizeof(report) - 1, 0, reinterpret_cast<const sockaddr*>(&destination), sizeof(destination));
+		close(sender);
+		for (int i = 0; i < 200 && infoChannel(node, "feedbackMotors") < 3; i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			cook.run(node, inputs);
+		}
+		CHECK(infoChannel(node, "feedbackMotors") == 3, "%g motors reported", infoChannel(node, "feedbackMotors"));
+		CHECK(std::abs(infoChannel(node, "feedbackError") - 0.2f) < 1e-4f, "feedbackError is %g",
+			  infoChannel(node, "feedbackError"));
+	}
+	return cook.output->channels[KineticLight::motorSlot(1) - 1][0];
+}
+
+static void cueCorrected() {
+	float open = cueMotorValue(false);
+	float corrected = cueMotorValue(true);
+	CHECK(corrected > open, "the cue's motor output %g with feedback, %g without", corrected, open);
+	printf("cue playback is corrected from the reports\n");
+}
+
+int main() {
+	convergence();
+	derivativeAfterGap();
+	reportIntegratedOnce();
+	cueCorrected();
+	return 0;
+}
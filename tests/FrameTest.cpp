@@ -0,0 +1,82 @@
+/* Checks which frame the node outputs when it can't compute a new one:
+* after a layout change, with and without Async Cook, and when the frame is
+* invalid.
+*/
+
+#include "TestInputs.h"
+
+const int32_t FIXTURES = 8;
+
+// The first motor's DMX value of 'fixture', in Channels output
+static float motorValue(const TestCook& cook, int32_t fixture) {
+	return cook.output->channels[fixture * KineticLight::NUM_SLOTS + KineticLight::motorSlot(1) - 1][0];
+}
+
+struct Rig {
+	Rig() : node(&nodeInfo), height({ "height" }, { 1.0f }, 1), roll({ "roll" }, { 10.0f }, 2),
+			pitch({ "pitch" }, { 5.0f }, 3), yaw({ "yaw" }, { 0.0f }, 4) {
+		inputs.numbers["Minheight"] = -3;
+		inputs.numbers["Fixtures"] = FIXTURES;
+		inputs.chops = { &height.input, &roll.input, &pitch.input, &yaw.input };
+	}
+
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node;
+	TestInputs inputs;
+	TestCHOP height, roll, pitch, yaw;
+	TestCook cook;
+};
+
+// Every cook right after a layout change outputs a computed frame, however
+// much latency the worker adds
+static void layoutChange(bool async) {
+	Rig rig;
+	rig.inputs.numbers["Async"] = async;
+	rig.inputs.numbers["Asynclatency"] = 1;
+	for (int i = 0; i < 5; i++)
+		rig.cook.run(rig.node, rig.inputs);
+	float before = motorValue(rig.cook, 0);
+	CHECK(before > 0.0f, "no motor output before the layout change");
+
+	for (int32_t fixtures : { FIXTURES + 1, FIXTURES + 1, FIXTURES - 2 }) {
+		rig.inputs.numbers["Fixtures"] = fixtures;
+		rig.cook.run(rig.node, rig.inputs);
+		for (int32_t f = 0; f < fixtures; f++)
+			CHECK(motorValue(rig.cook, f) == before, "%s, %d fixtures: fixture %d output %g instead of %g",
+				  async ? "async" : "sync", fixtures, f, motorValue(rig.cook, f), before);
+	}
+	printf("%s: no empty frames after layout changes\n", async ? "async" : "sync");
+}
+
+// An invalid height range holds the last valid frame instead of zeroing it
+static void invalidFrame() {
+	Rig rig;
+	for (int i = 0; i < 3; i++)
+		rig.cook.run(rig.node, rig.inputs);
+	float before = motorValue(rig.cook, 0);
+	CHECK(before > 0.0f, "no motor output before the invalid frame");
+	CHECK(infoChannel(rig.node, "heldFrames") == 0.0f, "frames held before any were invalid");
+
+	rig.inputs.numbers["Maxheight"] = rig.inputs.numbers["Minheight"];
+	for (int i = 0; i < 3; i++) {
+		rig.height.set(0, 2.0f + i);
+		rig.cook.run(rig.node, rig.inputs);
+		CHECK(motorValue(rig.cook, 0) == before, "invalid frame %d output %g instead of holding %g", i,
+			  motorValue(rig.cook, 0), before);
+	}
+	CHECK(infoChannel(rig.node, "heldFrames") == 3.0f, "heldFrames is %g", infoChannel(rig.node, "heldFrames"));
+
+	// With nothing to hold the output is zeros
+	Rig fresh;
+	fresh.inputs.numbers["Maxheight"] = fresh.inputs.numbers["Minheight"];
+	fresh.cook.run(fresh.node, fresh.inputs);
+	CHECK(motorValue(fresh.cook, 0) == 0.0f, "invalid first frame output %g", motorValue(fresh.cook, 0));
+	printf("invalid frames hold the last valid one\n");
+}
+
+int main() {
+	layoutChange(false);
+	layoutChange(true);
+	invalidFrame();
+	return 0;
+}
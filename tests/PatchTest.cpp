@@ -0,0 +1,71 @@
+/* Checks that a Patch DAT cooking without changing leaves the fixtures and
+* their smoothing alone, and that a changed patch is picked up.
+*/
+
+#include "TestInputs.h"
+
+const int32_t FIXTURES = 4;
+const int COOKS = 30;
+
+// First motor's DMX value of every fixture, in Universes output with a
+// channel per slot
+static std::vector<float> motorValues(const TestCook& cook, const std::vector<int32_t>& addresses) {
+	std::vector<float> values;
+	for (int32_t address : addresses)
+		values.push_back(cook.output->channels[address - 1 + KineticLight::motorSlot(1) - 1][0]);
+	return values;
+}
+
+// Steps the height and cooks, cooking the Patch DAT along with the node
+// when 'cookDAT' is set, and returns the motor values of every cook
+static std::vector<std::vector<float>> run(bool cookDAT) {
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+	TestInputs inputs;
+	inputs.numbers["Minheight"] = -3;
+	inputs.numbers["Fixtures"] = FIXTURES;
+	inputs.numbers["Outputmode"] = 1;
+	inputs.numbers["Startuniverse"] = 1;
+	inputs.numbers["Smoothmode"] = 2;
+	inputs.numbers["Smoothspringtime"] = 0.5;
+	TestDAT patch({ { "fixture", "universe", "address" }, { "1", "1", "1" }, { "2", "1", "81" }, { "3", "1", "161" },
+					{ "4", "1", "241" } }, 7);
+	inputs.dats["Patchdat"] = &patch.input;
+	TestCHOP height({ "height" }, { 1.0f }, 1);
+	TestCHOP roll({ "roll" }, { 10.0f }, 2);
+	inputs.chops = { &height.input, &roll.input };
+
+	std::vector<std::vector<float>> values;
+	TestCook cook;
+	for (int i = 0; i < COOKS; i++) {
+		if (i == 5)
+			height.set(0, 2.0f);
+		if (cookDAT)
+			patch.cook();
+		cook.run(node, inputs);
+		values.push_back(motorValues(cook, { 1, 81, 161, 241 }));
+	}
+
+	// A real change moves the fixture
+	patch.set({ { "fixture", "universe", "address" }, { "1", "1", "1" }, { "2", "1", "81" }, { "3", "1", "161" },
+				{ "4", "1", "321" } });
+	for (int i = 0; i < 3; i++)
+		cook.run(node, inputs);
+	CHECK(motorValues(cook, { 321 })[0] > 0.0f, "fixture 4 didn't move to address 321");
+	CHECK(motorValues(cook, { 241 })[0] == 0.0f, "fixture 4 is still at address 241");
+	return values;
+}
+
+int main() {
+	std::vector<std::vector<float>> still = run(false);
+	std::vector<std::vector<float>> cooking = run(true);
+	CHECK(still[COOKS - 1][0] != still[5][0], "the step never reached the output");
+	CHECK(still[6][0] != still[COOKS - 1][0], "the spring didn't smooth the step");
+	for (int i = 0; i < COOKS; i++) {
+		for (int32_t f = 0; f < FIXTURES; f++)
+			CHECK(still[i][f] == cooking[i][f], "cook %d: fixture %d output %g with the DAT cooking, %g without", i, f,
+				  cooking[i][f], still[i][f]);
+	}
+	printf("a Patch DAT cooking every frame doesn't restart the fixtures\n");
+	return 0;
+}
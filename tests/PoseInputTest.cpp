@@ -0,0 +1,83 @@
+/* Checks which samples of the pose and speed inputs a cook takes: the
+* filters are only fed samples they haven't seen, and the speed comes from
+* the newest sample, like the pose.
+*/
+
+#include "TestInputs.h"
+
+const int32_t FIXTURES = 2;
+const int COOKS = 20;
+
+// The first motor's DMX value and speed of 'fixture', in Channels output
+static float motorValue(const TestCook& cook, int32_t fixture) {
+	return cook.output->channels[fixture * KineticLight::NUM_SLOTS + KineticLight::motorSlot(1) - 1][0];
+}
+
+static float motorSpeed(const TestCook& cook, int32_t fixture) {
+	return cook.output->channels[fixture * KineticLight::NUM_SLOTS + KineticLight::motorSlot(1) + 1][0];
+}
+
+// Cooks with 'height' as the height input under spring smoothing and
+// returns the first motor's value of every cook
+static std::vector<float> run(const OP_CHOPInput* height) {
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+	TestInputs inputs;
+	inputs.numbers["Minheight"] = -3;
+	inputs.numbers["Fixtures"] = FIXTURES;
+	inputs.numbers["Smoothmode"] = 2;
+	inputs.numbers["Smoothspringtime"] = 0.5;
+	TestCHOP roll({ "roll" }, { 10.0f }, 2);
+	inputs.chops = { height, &roll.input };
+
+	std::vector<float> values;
+	TestCook cook;
+	for (int i = 0; i < COOKS; i++) {
+		cook.run(node, inputs);
+		values.push_back(motorValue(cook, 0));
+	}
+	return values;
+}
+
+// A clip that doesn't change is the newest sample held, not replayed into
+// the filters every cook
+static void clipHeld() {
+	std::vector<float> ramp;
+	for (int s = 0; s < 100; s++)
+		ramp.push_back(-2.0f + s * 0.04f);
+	ClipCHOP clip("height", ramp, 1);
+	TestCHOP newest({ "height" }, { ramp.back() }, 1);
+
+	std::vector<float> fromClip = run(&clip.input);
+	std::vector<float> fromNewest = run(&newest.input);
+	for (int i = 0; i < COOKS; i++)
+		CHECK(fromClip[i] == fromNewest[i], "cook %d: the clip output %g, its newest sample %g", i, fromClip[i],
+			  fromNewest[i]);
+	printf("a clip that doesn't change feeds the filters its newest sample\n");
+}
+
+// The speed comes from the newest sample of its input
+static void newestSpeed() {
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+	TestInputs inputs;
+	inputs.numbers["Minheight"] = -3;
+	inputs.numbers["Fixtures"] = FIXTURES;
+	TestCHOP height({ "height" }, { 1.0f }, 1);
+	TestCHOP roll({ "roll" }, { 0.0f }, 2);
+	TestCHOP pitch({ "pitch" }, { 0.0f }, 3);
+	TestCHOP yaw({ "yaw" }, { 0.0f }, 4);
+	ClipCHOP speed("speed", { 10.0f, 20.0f, 200.0f }, 5);
+	inputs.chops = { &height.input, &roll.input, &pitch.input, &yaw.input, &speed.input };
+
+	TestCook cook;
+	cook.run(node, inputs);
+	CHECK(motorSpeed(cook, 0) == 200.0f, "speed is %g instead of the newest sample", motorSpeed(cook, 0));
+	printf("speed comes from the newest sample\n");
+}
+
+int main() {
+	clipHeld();
+	newestSpeed();
+	return 0;
+}
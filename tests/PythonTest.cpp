@@ -0,0 +1,136 @@
+/* Calls the Python batch API the way TouchDesigner does, through the
+* plugin's method table: the heights and DMX values it writes match
+* calculateMotorHeights() and heightToDMX(), and buffers of the wrong type
+* or size are rejected.
+*/
+
+// Python.h has to come before any standard headers
+#include <Python.h>
+
+#include "TestInputs.h"
+
+#include <array>
+
+std::array<double, 3> calculateMotorHeights(double base_size, double roll_deg, double pitch_deg, double yaw_deg);
+uint8_t heightToDMX(float height, float min_height, float max_height, float min_dmx, float max_dmx);
+extern "C" void FillCHOPPluginInfo(CHOP_PluginInfo* info);
+
+const size_t FIXTURES = 3;
+
+// Hands the node to the methods in place of the one TouchDesigner looks up
+class TestContext : public PY_Context {
+public:
+	explicit TestContext(void* node) : node(node) {}
+	void* getNodeInstance(const PY_GetInfo&, void*) override { return node; }
+	void makeNodeDirty(void*) override {}
+
+	void* node;
+};
+
+static PyCFunction method(const CHOP_PluginInfo& info, const char* name) {
+	for (const PyMethodDef* m = info.customOPInfo.pythonMethods; m->ml_name; m++) {
+		if (!strcmp(m->ml_name, name))
+			return m->ml_meth;
+	}
+	CHECK(false, "no %s() method", name);
+	return nullptr;
+}
+
+static PyObject* evaluate(const char* expression) {
+	PyObject* globals = PyModule_GetDict(PyImport_AddModule("__main__"));
+	PyObject* result = PyRun_String(expression, Py_eval_input, globals, globals);
+	if (!result)
+		PyErr_Print();
+	CHECK(result, "couldn't evaluate %s", expression);
+	return result;
+}
+
+// Calls 'solve' with 'args' and checks it raises 'error'
+static void rejects(PyCFunction solve, PyObject* self, PyObject* args, PyObject* error, const char* what) {
+	PyObject* result = solve(self, args);
+	CHECK(!result && PyErr_ExceptionMatches(error), "%s wasn't rejected", what);
+	PyErr_Clear();
+	Py_DECREF(args);
+}
+
+int main() {
+	Py_Initialize();
+
+	CHOP_PluginInfo info = CHOP_PluginInfo();
+	TestString opType, opLabel, opIcon, authorName, authorEmail, pythonVersion;
+	info.customOPInfo.opType = &opType;
+	info.customOPInfo.opLabel = &opLabel;
+	info.customOPInfo.opIcon = &opIcon;
+	info.customOPInfo.authorName = &authorName;
+	info.customOPInfo.authorEmail = &authorEmail;
+	info.customOPInfo.pythonVersion = &pythonVersion;
+	FillCHOPPluginInfo(&info);
+	CHECK(pythonVersion.text == PY_VERSION, "built for Python %s", pythonVersion.text.c_str());
+	PyCFunction solvePoses = method(info, "solvePoses");
+
+	// The methods solve with the mapping of the node's last cook
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+	TestInputs inputs;
+	inputs.numbers["Minheight"] = -3;
+	inputs.numbers["Basesize"] = 1.2;
+	inputs.numbers["Calibrationmaxheight"] = 2.5;
+	inputs.numbers["Calibrationmindmxout"] = 10;
+	TestCook cook;
+	cook.run(node, inputs);
+
+	TestContext context(&node);
+	PY_Struct* self = static_cast<PY_Struct*>(calloc(1, sizeof(PY_Struct)));
+	self->context = &context;
+	PyObject* me = reinterpret_cast<PyObject*>(self);
+
+	const float poses[FIXTURES][4] = { { 1.0f, 10.0f, 0.0f, 0.0f }, { 1.5f, -5.0f, 20.0f, 30.0f }, { 2.4f, 0.0f, 15.0f, 0.0f } };
+	PyRun_SimpleString("import array\n"
+					   "poses = array.array('f', [1.0, 10, 0, 0, 1.5, -5, 20, 30, 2.4, 0, 15, 0])\n"
+					   "heights = array.array('f', [0.0] * 9)\n"
+					   "dmx = bytearray(9)\n");
+
+	// Into new bytearrays, and into buffers passed in
+	const char* calls[] = { "(poses,)", "(poses, heights, dmx)" };
+	for (const char* call : calls) {
+		PyObject* result = solvePoses(me, evaluate(call));
+		if (!result)
+			PyErr_Print();
+		CHECK(result && PyTuple_Check(result) && PyTuple_Size(result) == 2, "solvePoses%s didn't return (heights, dmx)", call);
+		Py_buffer heights, dmx;
+		CHECK(PyObject_GetBuffer(PyTuple_GetItem(result, 0), &heights, PyBUF_SIMPLE) == 0, "heights aren't a buffer");
+		CHECK(PyObject_GetBuffer(PyTuple_GetItem(result, 1), &dmx, PyBUF_SIMPLE) == 0, "DMX isn't a buffer");
+		CHECK(heights.len == FIXTURES * 3 * sizeof(float) && dmx.len == FIXTURES * 3, "%zd bytes of heights, %zd of DMX",
+			  heights.len, dmx.len);
+
+		for (size_t f = 0; f < FIXTURES; f++) {
+			std::array<double, 3> expected = calculateMotorHeights(1.2, poses[f][1], poses[f][2], poses[f][3]);
+			for (int m = 0; m < 3; m++) {
+				float height = static_cast<const float*>(heights.buf)[f * 3 + m];
+				uint8_t value = static_cast<const uint8_t*>(dmx.buf)[f * 3 + m];
+				CHECK(fabs(height - expected[m]) < 1e-5, "solvePoses%s: fixture %zu motor %d at %g instead of %g", call,
+					  f, m, height, expected[m]);
+				uint8_t expectedValue = heightToDMX(static_cast<float>(expected[m]) + poses[f][0], 0.5f, 2.5f, 10.0f, 255.0f);
+				CHECK(value == expectedValue, "solvePoses%s: fixture %zu motor %d sends %d instead of %d", call, f, m,
+					  value, expectedValue);
+			}
+		}
+		PyBuffer_Release(&heights);
+		PyBuffer_Release(&dmx);
+		Py_DECREF(result);
+	}
+	printf("heights and DMX match calculateMotorHeights() and heightToDMX()\n");
+
+	rejects(solvePoses, me, evaluate("(array.array('d', [1, 0, 0, 0]),)"), PyExc_TypeError, "float64 poses");
+	rejects(solvePoses, me, evaluate("(array.array('f', [1, 0, 0]),)"), PyExc_TypeError, "a partial pose");
+	rejects(solvePoses, me, evaluate("(poses, bytearray(36))"), PyExc_TypeError, "uint8 heights");
+	rejects(solvePoses, me, evaluate("(poses, heights, array.array('H', [0] * 9))"), PyExc_TypeError, "uint16 DMX");
+	rejects(solvePoses, me, evaluate("(poses, array.array('f', [0.0] * 8))"), PyExc_ValueError, "short heights");
+	rejects(solvePoses, me, evaluate("(poses, heights, bytearray(8))"), PyExc_ValueError, "short DMX");
+	rejects(solvePoses, me, evaluate("(poses, bytes(36))"), PyExc_BufferError, "read-only heights");
+	printf("buffers of the wrong type or size are rejected\n");
+
+	free(self);
+	Py_Finalize();
+	return 0;
+}
@@ -0,0 +1,99 @@
+/* Records frames to a file and reads them back: a recorder pushed faster
+* than its writer keeps up writes a frame per push, repeating the frame
+* before each dropped one, and a recording through the node starts at the
+* timeline frame it started on.
+*/
+
+#include "TestInputs.h"
+
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+// Pushes numbered frames into a two frame ring as fast as they come
+static void dropsHeld(const std::string& path) {
+	const size_t numFixtures = 50;
+	const size_t numSlots = numFixtures * KineticLight::NUM_SLOTS;
+	const uint64_t numFrames = 3000;
+
+	FrameRecorder recorder;
+	CHECK(recorder.start(path.c_str(), numFixtures, 2, 30, true, 12.0, 30.0), "the recorder didn't start");
+	std::vector<uint8_t> slots(numSlots, 0);
+	for (uint64_t f = 0; f < numFrames; f++) {
+		slots[0] = static_cast<uint8_t>(f);
+		slots[1] = static_cast<uint8_t>(f >> 8);
+		slots[numSlots - 1] = static_cast<uint8_t>(f * 7);
+		recorder.push(slots.data());
+	}
+	recorder.stop();
+	while (recorder.isWriting())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	CHECK(!recorder.hasFailed(), "writing %s failed", path.c_str());
+	uint64_t dropped = recorder.getFramesDropped();
+
+	MappedFile file;
+	CHECK(file.open(path.c_str()), "couldn't map %s", path.c_str());
+	const BakeHeader* header = reinterpret_cast<const BakeHeader*>(file.data());
+	CHECK(header->numFrames == numFrames, "%u frames written for %llu pushed", header->numFrames,
+		  (unsigned long long)numFrames);
+	CHECK(header->startIndex == 12.0 && header->sampleRate == 30.0, "start %g at %g fps", header->startIndex,
+		  header->sampleRate);
+
+	// Each frame is the one pushed there, or a repeat of the frame before it
+	const BakeFrameEntry* index = reinterpret_cast<const BakeFrameEntry*>(file.data() + header->indexOffset);
+	std::vector<uint8_t> decoded(numSlots, 0);
+	uint64_t held = 0;
+	uint64_t shown = 0;
+	for (uint64_t f = 0; f < numFrames; f++) {
+		CHECK(applyBakeFrame(file.data(), index[f], decoded.data(), numSlots), "frame %llu is malformed",
+			  (unsigned long long)f);
+		uint64_t number = decoded[0] | decoded[1] << 8;
+		CHECK(decoded[numSlots - 1] == static_cast<uint8_t>(number * 7), "frame %llu is torn", (unsigned long long)f);
+		if (number == f)
+			shown = f;
+		else {
+			CHECK(f > 0 && number == shown, "frame %llu holds pushed frame %llu", (unsigned long long)f,
+				  (unsigned long long)number);
+			held++;
+		}
+	}
+	CHECK(held == dropped, "%llu frames held for %llu dropped", (unsigned long long)held, (unsigned long long)dropped);
+	file.close();
+	printf("%llu frames pushed, %llu dropped and held\n", (unsigned long long)numFrames, (unsigned long long)dropped);
+}
+
+// A recording started on timeline frame 101 starts at sample 100
+static void startFrame(const std::string& path) {
+	{
+		OP_NodeInfo nodeInfo = OP_NodeInfo();
+		CPlusPlusCHOPExample node(&nodeInfo);
+		TestInputs inputs;
+		inputs.numbers["Fixtures"] = 2;
+		inputs.strings["Recordfile"] = path;
+		inputs.numbers["Record"] = 1;
+		TestCook cook;
+		for (int i = 0; i < 5; i++) {
+			inputs.time.frame = 101 + i;
+			cook.run(node, inputs);
+		}
+		inputs.numbers["Record"] = 0;
+		cook.run(node, inputs);
+	}
+
+	MappedFile file;
+	CHECK(file.open(path.c_str()), "couldn't map %s", path.c_str());
+	const BakeHeader* header = reinterpret_cast<const BakeHeader*>(file.data());
+	CHECK(header->numFrames == 5, "%u frames recorded", header->numFrames);
+	CHECK(header->startIndex == 100.0 && header->sampleRate == 60.0, "start %g at %g fps", header->startIndex,
+		  header->sampleRate);
+	file.close();
+	printf("a recording starts at the timeline frame it started on\n");
+}
+
+int main() {
+	std::string path = "/tmp/RecordTest-" + std::to_string(getpid()) + ".kdmx";
+	dropsHeld(path);
+	startFrame(path);
+	remove(path.c_str());
+	return 0;
+}
@@ -0,0 +1,88 @@
+/* Checks where sACN goes without a Destination: each universe to its own
+* multicast group, received here through the loopback of multicast
+* packets. Start Universe is kept within sACN's universes.
+*/
+
+#include "TestInputs.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+// A socket receiving only 'group', 239.255.<high byte>.<low byte> of 'universe'
+static int joinUniverse(int32_t universe) {
+	int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	CHECK(handle != -1, "couldn't open a socket");
+	int reuse = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	timeval timeout = { 1, 0 };
+	setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	// Bound to the group itself, so other groups' packets aren't delivered
+	sockaddr_in local = {};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(5568);
+	local.sin_addr.s_addr = htonl(0xEFFF0000u | static_cast<uint32_t>(universe));
+	CHECK(bind(handle, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) == 0, "couldn't bind universe %d's group",
+		  universe);
+	ip_mreq membership = {};
+	membership.imr_multiaddr = local.sin_addr;
+	membership.imr_interface.s_addr = htonl(INADDR_ANY);
+	CHECK(setsockopt(handle, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == 0,
+		  "couldn't join universe %d's group", universe);
+	return handle;
+}
+
+// Universes 255 and 256 go to 239.255.0.255 and 239.255.1.0
+static void multicast() {
+	const int32_t first = 255;
+	int groups[2] = { joinUniverse(first), joinUniverse(first + 1) };
+
+	DMXSocket socket;
+	CHECK(socket.open(DMXProtocol::Sacn, "", first, 2), "sACN without a Destination didn't open");
+	std::vector<uint8_t> universes(2 * DMX_UNIVERSE_SIZE, 0);
+	universes[0] = 11;
+	universes[DMX_UNIVERSE_SIZE] = 22;
+	CHECK(socket.send(universes.data(), 1), "sending to the multicast groups failed");
+
+	for (int u = 0; u < 2; u++) {
+		uint8_t packet[1500];
+		ssize_t size = recv(groups[u], packet, sizeof(packet), 0);
+		CHECK(size == 126 + DMX_UNIVERSE_SIZE, "universe %d's group received %zd bytes", first + u, size);
+		int32_t universe = packet[113] << 8 | packet[114];
+		CHECK(universe == first + u, "universe %d's group received universe %d", first + u, universe);
+		CHECK(packet[126] == universes[u * DMX_UNIVERSE_SIZE], "universe %d's slots differ", first + u);
+		close(groups[u]);
+	}
+
+	CHECK(!socket.open(DMXProtocol::Sacn, "", 0, 2), "sACN opened with universe 0");
+	CHECK(!socket.open(DMXProtocol::Sacn, "", 63999, 2), "sACN opened with universe 64000");
+	printf("sACN without a Destination reaches each universe's multicast group\n");
+}
+
+// Start Universe 0 patches sACN from universe 1
+static void startUniverse() {
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node(&nodeInfo);
+	TestInputs inputs;
+	inputs.numbers["Outputmode"] = 1;
+	inputs.numbers["Startuniverse"] = 0;
+	TestCook cook;
+	TestString name;
+
+	cook.run(node, inputs);
+	node.getChannelName(0, &name, &inputs, nullptr);
+	CHECK(name.text == "u0_s1", "Art-Net patched from %s", name.text.c_str());
+
+	inputs.numbers["Sendprotocol"] = 1;
+	cook.run(node, inputs);
+	node.getChannelName(0, &name, &inputs, nullptr);
+	CHECK(name.text == "u1_s1", "sACN patched from %s", name.text.c_str());
+	printf("Start Universe stays within sACN's universes\n");
+}
+
+int main() {
+	multicast();
+	startUniverse();
+	return 0;
+}
@@ -0,0 +1,82 @@
+/* Checks that the safety envelope's speed limit holds across layout
+* changes, and that limit hits add up over the steps of a frame.
+*/
+
+#include "TestInputs.h"
+
+const int32_t FIXTURES = 4;
+
+// The first motor's DMX value of 'fixture', in Channels output
+static float motorValue(const TestCook& cook, int32_t fixture) {
+	return cook.output->channels[fixture * KineticLight::NUM_SLOTS + KineticLight::motorSlot(1) - 1][0];
+}
+
+struct Rig {
+	Rig() : node(&nodeInfo), height({ "height" }, { 1.0f }, 1), roll({ "roll" }, { 10.0f }, 2) {
+		inputs.numbers["Minheight"] = -3;
+		inputs.numbers["Fixtures"] = FIXTURES;
+		inputs.numbers["Safety"] = 1;
+		inputs.numbers["Safeminheight"] = -3;
+		inputs.numbers["Safemaxheight"] = 3;
+		inputs.numbers["Safeknee"] = 0.01;
+		inputs.numbers["Safemaxspread"] = 10;
+		inputs.numbers["Safemaxspeed"] = 0.5;
+		inputs.time.deltaMS = 1000.0 / 60.0;
+		inputs.chops = { &height.input, &roll.input };
+	}
+
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	CPlusPlusCHOPExample node;
+	TestInputs inputs;
+	TestCHOP height, roll;
+	TestCook cook;
+};
+
+// A height step taken along with a layout change moves the fixtures that
+// remain no faster than without the change
+static void layoutChange() {
+	Rig still, changed;
+	for (Rig* rig : { &still, &changed }) {
+		for (int i = 0; i < 5; i++)
+			rig->cook.run(rig->node, rig->inputs);
+		rig->height.set(0, 2.5f);
+	}
+	changed.inputs.numbers["Fixtures"] = FIXTURES + 1;
+
+	float before = motorValue(still.cook, 0);
+	for (int i = 0; i < 10; i++) {
+		still.cook.run(still.node, still.inputs);
+		changed.cook.run(changed.node, changed.inputs);
+		for (int32_t f = 0; f < FIXTURES; f++)
+			CHECK(motorValue(changed.cook, f) == motorValue(still.cook, f),
+				  "cook %d: fixture %d output %g after the layout change, %g without", i, f,
+				  motorValue(changed.cook, f), motorValue(still.cook, f));
+	}
+	CHECK(motorValue(still.cook, 0) != before, "the step never reached the output");
+	CHECK(infoChannel(still.node, "limitedFixtures") == FIXTURES, "limitedFixtures is %g",
+		  infoChannel(still.node, "limitedFixtures"));
+	printf("the speed limit holds across a layout change\n");
+}
+
+// A limit hit on one step of a frame isn't cleared by the steps after it
+static void hitsAddUp() {
+	SafetyEnvelope envelope;
+	envelope.resize(1);
+	SafetyLimits limits = { true, -3.0f, 3.0f, 0.01f, 10.0f, 1.0f };
+	uint8_t hits = 0;
+	float heights[3] = { 0.0f, 0.0f, 0.0f };
+	envelope.process(heights, 1, 0.1f, limits, &hits);
+	float fast[3] = { 1.0f, 1.0f, 1.0f };
+	envelope.process(fast, 1, 0.1f, limits, &hits);
+	CHECK(hits == LIMIT_SPEED, "hits are %d after a fast step", hits);
+	float slow[3] = { fast[0], fast[1], fast[2] };
+	envelope.process(slow, 1, 0.1f, limits, &hits);
+	CHECK(hits == LIMIT_SPEED, "a slow step cleared the hits to %d", hits);
+	printf("limit hits add up over a frame's steps\n");
+}
+
+int main() {
+	layoutChange();
+	hitsAddUp();
+	return 0;
+}
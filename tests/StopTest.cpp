@@ -0,0 +1,44 @@
+/* Checks that stopping the DMX sender and the receivers doesn't wait on
+* their threads: a sender sleeping out a long period, and receivers
+* blocked on sockets nothing sends to.
+*/
+
+#include "TestInputs.h"
+
+#include <chrono>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+// Well under the sender's period and the receivers' receive timeout
+const double MAX_STOP_MS = 30.0;
+
+// How long stop() takes once the thread has had time to go to sleep
+template <typename T>
+static double stopMilliseconds(T& thread) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	Clock::time_point start = Clock::now();
+	thread.stop();
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main() {
+	DMXSender sender;
+	CHECK(sender.start(DMXProtocol::ArtNet, "127.0.0.1", 1.0, 0, 1), "the sender didn't start");
+	double senderStop = stopMilliseconds(sender);
+	CHECK(senderStop < MAX_STOP_MS, "the sender took %g ms to stop", senderStop);
+	printf("the sender stopped in %g ms\n", senderStop);
+
+	DMXReceiver receiver;
+	CHECK(receiver.start(46454, nullptr, 0, 1), "the DMX receiver didn't start");
+	double receiverStop = stopMilliseconds(receiver);
+	CHECK(receiverStop < MAX_STOP_MS, "the DMX receiver took %g ms to stop", receiverStop);
+	printf("the DMX receiver stopped in %g ms\n", receiverStop);
+
+	FeedbackReceiver feedback;
+	CHECK(feedback.start(46455, 1), "the feedback receiver didn't start");
+	double feedbackStop = stopMilliseconds(feedback);
+	CHECK(feedbackStop < MAX_STOP_MS, "the feedback receiver took %g ms to stop", feedbackStop);
+	printf("the feedback receiver stopped in %g ms\n", feedbackStop);
+	return 0;
+}
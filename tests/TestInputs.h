@@ -0,0 +1,259 @@
+/* Stand-ins for the parts of the TouchDesigner API a cook goes through, so
+* the node can be cooked headless by the tests in this directory.
+*/
+
+#pragma once
+
+#include "KineticCHOP.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fails the test with 'message' if 'condition' doesn't hold
+#define CHECK(condition, ...) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			exit(1); \
+		} \
+	} while (0)
+
+class TestString : public OP_String {
+public:
+	void setString(const char* value) override { text = value ? value : ""; }
+
+	std::string text;
+};
+
+// A CHOP input with one sample per channel. Values can be changed in place
+// between cooks.
+class TestCHOP {
+public:
+	TestCHOP(const std::vector<std::string>& channelNames, const std::vector<float>& values, uint32_t opId)
+		: names(channelNames), data(values) {
+		for (size_t i = 0; i < data.size(); i++) {
+			channels.push_back(&data[i]);
+			namePointers.push_back(names[i].c_str());
+		}
+		memset(&input, 0, sizeof(input));
+		input.opPath = "/test/chop";
+		input.opId = opId;
+		input.numChannels = static_cast<int32_t>(data.size());
+		input.numSamples = 1;
+		input.sampleRate = 60;
+		input.channelData = channels.data();
+		input.nameData = namePointers.data();
+	}
+
+	void set(size_t channel, float value) {
+		data[channel] = value;
+		input.totalCooks++;
+	}
+
+	// Renames in place, so a name no longer than the old one keeps its
+	// storage, as TouchDesigner may
+	void rename(size_t channel, const char* name) {
+		names[channel].assign(name);
+		namePointers[channel] = names[channel].c_str();
+		input.totalCooks++;
+	}
+
+	OP_CHOPInput input;
+
+private:
+	std::vector<std::string> names;
+	std::vector<float> data;
+	std::vector<const float*> channels;
+	std::vector<const char*> namePointers;
+};
+
+// A one channel CHOP input holding a whole clip, that isn't timesliced
+class ClipCHOP {
+public:
+	ClipCHOP(const char* channelName, const std::vector<float>& samples, uint32_t opId)
+		: name(channelName), data(samples) {
+		channel = data.data();
+		memset(&input, 0, sizeof(input));
+		input.opPath = "/test/clip";
+		input.opId = opId;
+		input.numChannels = 1;
+		input.numSamples = static_cast<int32_t>(data.size());
+		input.sampleRate = 60;
+		input.channelData = &channel;
+		input.nameData = &name;
+		input.totalCooks = 1;
+	}
+
+	float sample(size_t index) const { return data[index]; }
+
+	OP_CHOPInput input;
+
+private:
+	const char* name;
+	std::vector<float> data;
+	const float* channel;
+};
+
+// A table DAT. Cells can be changed between cooks; cook() tells the node.
+class TestDAT {
+public:
+	TestDAT(const std::vector<std::vector<std::string>>& rows, uint32_t opId) {
+		memset(&input, 0, sizeof(input));
+		input.opPath = "/test/dat";
+		input.opId = opId;
+		input.isTable = true;
+		set(rows);
+	}
+
+	void set(const std::vector<std::vector<std::string>>& rows) {
+		cells.clear();
+		for (const auto& row : rows)
+			cells.insert(cells.end(), row.begin(), row.end());
+		cellPointers.clear();
+		for (const std::string& cell : cells)
+			cellPointers.push_back(cell.c_str());
+		input.numRows = static_cast<int32_t>(rows.size());
+		input.numCols = rows.empty() ? 0 : static_cast<int32_t>(rows[0].size());
+		input.cellData = cellPointers.data();
+		cook();
+	}
+
+	void cook() { input.totalCooks++; }
+
+	OP_DATInput input;
+
+private:
+	std::vector<std::string> cells;
+	std::vector<const char*> cellPointers;
+};
+
+// Parameters are looked up by name; menus are read as their index, like
+// TouchDesigner does with getParInt(). Anything not set reads as 0 or "".
+class TestInputs : public OP_Inputs {
+public:
+	TestInputs() : time() {
+		numbers["Basesize"] = 1.0;
+		numbers["Minheight"] = 0.5;
+		numbers["Maxheight"] = 3.0;
+		numbers["Calibrationminheight"] = 0.5;
+		numbers["Calibrationmaxheight"] = 3.0;
+		numbers["Calibrationmindmxout"] = 0;
+		numbers["Calibrationmaxdmxout"] = 255;
+		time.rate = 60;
+	}
+
+	int32_t getNumInputs() const override { return static_cast<int32_t>(chops.size()); }
+	const OP_CHOPInput* getInputCHOP(int32_t index) const override {
+		return index >= 0 && index < getNumInputs() ? chops[index] : nullptr;
+	}
+
+	double getParDouble(const char* name, int32_t) const override { return number(name); }
+	bool getParDouble2(const char*, double&, double&) const override { return false; }
+	bool getParDouble3(const char*, double&, double&, double&) const override { return false; }
+	bool getParDouble4(const char*, double&, double&, double&, double&) const override { return false; }
+	int32_t getParInt(const char* name, int32_t) const override { return static_cast<int32_t>(number(name)); }
+	bool getParInt2(const char*, int32_t&, int32_t&) const override { return false; }
+	bool getParInt3(const char*, int32_t&, int32_t&, int32_t&) const override { return false; }
+	bool getParInt4(const char*, int32_t&, int32_t&, int32_t&, int32_t&) const override { return false; }
+	const char* getParString(const char* name) const override {
+		auto it = strings.find(name);
+		return it == strings.end() ? "" : it->second.c_str();
+	}
+	const char* getParFilePath(const char* name) const override { return getParString(name); }
+	void enablePar(const char*, bool) const override {}
+	const OP_TimeInfo* getTimeInfo() const override { return &time; }
+
+	const OP_TOPInputOpenGL* getInputTOPOpenGL(int32_t) const override { return nullptr; }
+	const OP_DATInput* getParDAT(const char* name) const override {
+		auto it = dats.find(name);
+		return it == dats.end() ? nullptr : it->second;
+	}
+	const OP_TOPInputOpenGL* getParTOPOpenGL(const char*) const override { return nullptr; }
+	const OP_CHOPInput* getParCHOP(const char*) const override { return nullptr; }
+	const OP_ObjectInput* getParObject(const char*) const override { return nullptr; }
+	bool getRelativeTransform(const char*, const char*, double[4][4]) const override { return false; }
+	const OP_DATInput* getDAT(const char*) const override { return nullptr; }
+	const OP_TOPInputOpenGL* getTOPOpenGL(const char*) const override { return nullptr; }
+	const OP_CHOPInput* getCHOP(const char*) const override { return nullptr; }
+	const OP_ObjectInput* getObject(const char*) const override { return nullptr; }
+	void* getTOPDataInCPUMemory(const OP_TOPInputOpenGL*, const OP_TOPInputDownloadOptionsOpenGL*) const override { return nullptr; }
+	const OP_SOPInput* getParSOP(const char*) const override { return nullptr; }
+	const OP_SOPInput* getInputSOP(int32_t) const override { return nullptr; }
+	const OP_SOPInput* getSOP(const char*) const override { return nullptr; }
+	const OP_DATInput* getInputDAT(int32_t) const override { return nullptr; }
+	PyObject* getParPython(const char*) const override { return nullptr; }
+	const OP_TOPInput* getTOP(const char*) const override { return nullptr; }
+	const OP_TOPInput* getInputTOP(int32_t) const override { return nullptr; }
+	const OP_TOPInput* getParTOP(const char*) const override { return nullptr; }
+
+	std::vector<const OP_CHOPInput*> chops;
+	std::map<std::string, double, std::less<>> numbers;
+	std::map<std::string, std::string, std::less<>> strings;
+	std::map<std::string, const OP_DATInput*, std::less<>> dats;
+	OP_TimeInfo time;
+
+private:
+	double number(const char* name) const {
+		auto it = numbers.find(name);
+		return it == numbers.end() ? 0.0 : it->second;
+	}
+};
+
+// Value of the named Info CHOP channel, or NAN if there's none
+inline float infoChannel(CPlusPlusCHOPExample& node, const char* name) {
+	TestString channelName;
+	OP_InfoCHOPChan channel = OP_InfoCHOPChan();
+	channel.name = &channelName;
+	for (int32_t i = 0; i < node.getNumInfoCHOPChans(nullptr); i++) {
+		node.getInfoCHOPChan(i, &channel, nullptr);
+		if (channelName.text == name)
+			return channel.value;
+	}
+	return NAN;
+}
+
+// Runs the calls TouchDesigner makes for one cook. The output block is
+// only reallocated when its size changes, like TouchDesigner's.
+class TestCook {
+public:
+	void run(CPlusPlusCHOPExample& node, TestInputs& inputs) {
+		generalInfo = CHOP_GeneralInfo();
+		outputInfo = CHOP_OutputInfo();
+		node.getGeneralInfo(&generalInfo, &inputs, nullptr);
+		node.getOutputInfo(&outputInfo, &inputs, nullptr);
+		int32_t numSamples = generalInfo.timeslice ? 1 : outputInfo.numSamples;
+		if (!output || output->numChannels != outputInfo.numChannels || output->numSamples != numSamples)
+			allocate(outputInfo.numChannels, numSamples, outputInfo.sampleRate > 0 ? outputInfo.sampleRate : 60.0f);
+
+		uint64_t allocationsBefore = threadAllocationCount();
+		node.execute(output.get(), &inputs, nullptr);
+		executeAllocations = threadAllocationCount() - allocationsBefore;
+	}
+
+	CHOP_GeneralInfo generalInfo;
+	CHOP_OutputInfo outputInfo;
+	std::unique_ptr<CHOP_Output> output;
+	uint64_t executeAllocations = 0;
+
+private:
+	void allocate(int32_t numChannels, int32_t numSamples, float sampleRate) {
+		data.assign(static_cast<size_t>(numChannels) * numSamples, 0.0f);
+		channels.assign(numChannels, nullptr);
+		for (int32_t c = 0; c < numChannels; c++)
+			channels[c] = &data[static_cast<size_t>(c) * numSamples];
+		names.assign(numChannels, "");
+		output.reset(new CHOP_Output(numChannels, numSamples, sampleRate, 0, channels.data(), names.data()));
+	}
+
+	std::vector<float> data;
+	std::vector<float*> channels;
+	std::vector<const char*> names;
+};